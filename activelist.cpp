@@ -35,8 +35,11 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "rmap.h"
 
 #define MARRAY(j) (mArray[(j)%UARCH_OOO_DEGREE])
+#define MCOMPLETED(j) (bitvecIsSet(mCompleted, (j)%UARCH_OOO_DEGREE))
+#define MEXCEPTION(j) (bitvecIsSet(mException, (j)%UARCH_OOO_DEGREE))
  
-ULONG ActiveList::sizeActiveList() {
+template<class UArch>
+ULONG ActiveList<UArch>::sizeActiveList() {
   ULONG size;
   ULONG enqColor=mEnqPtr/UARCH_OOO_DEGREE;
   ULONG enqIdx=mEnqPtr%UARCH_OOO_DEGREE;
@@ -54,7 +57,8 @@ ULONG ActiveList::sizeActiveList() {
   return size;
 }
 
-bool ActiveList::isOlder(ULONG young, ULONG old) {
+template<class UArch>
+bool ActiveList<UArch>::isOlder(ULONG young, ULONG old) {
   ULONG size;
   ULONG oldColor=old/UARCH_OOO_DEGREE;
   ULONG oldIdx=old%UARCH_OOO_DEGREE;
@@ -72,35 +76,135 @@ bool ActiveList::isOlder(ULONG young, ULONG old) {
   return size;
 }
 
-ULONG ActiveList::q0GetPC(ULONG activeListIdx) {
+//
+// Number of consecutive entries, up to limit, starting at from that
+// are completed without exception.  Scans a word of status bits at a
+// time.
+//
+template<class UArch>
+ULONG ActiveList<UArch>::numRetirable(ULONG from, ULONG limit) {
+  ULONG idx=from%UARCH_OOO_DEGREE;
+  ULONG howmany=0;
+
+  while (howmany<limit) {
+    ULONG w=idx/BITVEC_WORD_BITS;
+    ULONG offset=idx%BITVEC_WORD_BITS;
+    ULONG span=MIN(MIN(BITVEC_WORD_BITS-offset, UARCH_OOO_DEGREE-idx), limit-howmany);
+    // bits above the word shift in as 0 and so end the run
+    ULONGLONG blocked=~((mCompleted[w]&~mException[w])>>offset);
+    ULONG run=blocked?__builtin_ctzll(blocked):BITVEC_WORD_BITS;
+
+    if (run<span) {
+      return howmany+run;
+    }
+    howmany+=span;
+    idx=(idx+span)%UARCH_OOO_DEGREE;
+  }
+
+  return howmany;
+}
+
+//
+// DRIS checker bookkeeping.  mDrisLastWriter[r] is the youngest
+// inflight writer of r, if any, and each inflight entry has a list of
+// the consumers still waiting on it.  Lookups and wakeups follow
+// these instead of scanning the activelist.
+//
+
+// set up operand which (0 for rs1; 1 for rs2) of entry j
+template<class UArch>
+void ActiveList<UArch>::drisLookup(ULONG j, ULONG which, LogicalRegName rs) {
+  RenameTag ts={.mapped=false, .idx=rs};
+  bool rdy=true;
+  ULONG k=(rs!=R0)?mDrisLastWriter[rs]:DRIS_NONE;
+
+  MARRAY(j).drisProducer[which]=DRIS_NONE;
+  if (k!=DRIS_NONE) {
+    ASSERT(MARRAY(k).rd==rs);
+    ts=MARRAY(k).drisTd;
+    rdy=MARRAY(k).drisIssued;  // ready when issued since alu 1-cycle
+			       // with forwarding
+    if (!rdy) {
+      MARRAY(j).drisProducer[which]=k;
+      MARRAY(j).drisNextWaiter[which]=MARRAY(k).drisWaiters;
+      MARRAY(k).drisWaiters=(2*j)+which;
+    }
+  }
+
+  if (which) {
+    MARRAY(j).drisTs2=ts;
+    MARRAY(j).drisTs2Rdy=rdy;
+  } else {
+    MARRAY(j).drisTs1=ts;
+    MARRAY(j).drisTs1Rdy=rdy;
+  }
+}
+
+// undo DRIS bookkeeping of the entries from enqPtr to mEnqPtr,
+// youngest first
+template<class UArch>
+void ActiveList<UArch>::drisUnwind(ULONG enqPtr) {
+  for(ULONG k=mEnqPtr; k!=enqPtr; ) {
+    k--;
+    k%=2*UARCH_OOO_DEGREE;
+
+    for(ULONG which=2; which--; ) {
+      // reverse of the linking order in drisLookup
+      ULONG p=MARRAY(k).drisProducer[which];
+      bool rdy=which?MARRAY(k).drisTs2Rdy:MARRAY(k).drisTs1Rdy;
+      if ((p!=DRIS_NONE)&&(!rdy)) {
+	// youngest waiter is at the head
+	ASSERT(MARRAY(p).drisWaiters==((2*k)+which));
+	MARRAY(p).drisWaiters=MARRAY(k).drisNextWaiter[which];
+      }
+    }
+
+    if (MARRAY(k).rd!=R0) {
+      ULONG prev=MARRAY(k).drisPrevWriter;
+      ASSERT(mDrisLastWriter[MARRAY(k).rd]==k);
+      if ((prev!=DRIS_NONE)&&isOlder(mDeqPtr,prev)) {
+	prev=DRIS_NONE;  // retired since
+      }
+      mDrisLastWriter[MARRAY(k).rd]=prev;
+    }
+  }
+}
+
+template<class UArch>
+bool ActiveList<UArch>::q0Empty() {
+  USAGEWARN((!simTock), "query after TOCK");
+
+  return (sizeActiveList()==0);
+}
+
+template<class UArch>
+ULONG ActiveList<UArch>::q0GetPC(ULONG activeListIdx) {
   USAGEWARN((!simTock), "query after TOCK");
   USAGEWARN(((dNumReadPC++)<MAX_ACTIVELIST_READPC), "exceeding number of ActiveList PC read port limit\n");
 
-#if (UARCH_ROB_RENAME)
-  ASSERT(activeListIdx<(2*UARCH_OOO_DEGREE));
-#else
-  ASSERT(activeListIdx<UARCH_OOO_DEGREE);
-#endif
+  ASSERT(activeListIdx<((UARCH_ROB_RENAME?2:1)*UARCH_OOO_DEGREE));
   ASSERT(MARRAY(activeListIdx).pcLike==
 	 MARRAY(activeListIdx).cookie.serial);
 
   return MARRAY(activeListIdx).pcLike;
 }
 
-ULONG ActiveList::q0GetExceptionPC() {
+template<class UArch>
+ULONG ActiveList<UArch>::q0GetExceptionPC() {
   USAGEWARN((!simTock), "query after TOCK");
 
-  ASSERT(MARRAY(mDeqPtr).completed);
-  ASSERT(MARRAY(mDeqPtr).exception);
+  ASSERT(MCOMPLETED(mDeqPtr));
+  ASSERT(MEXCEPTION(mDeqPtr));
 
   return q0GetPC(mDeqPtr%UARCH_OOO_DEGREE);
 }
 
-#if (!UARCH_ROB_RENAME)
-UnmapBundle ActiveList::q0Unmap() {
+template<class UArch>
+UnmapBundle ActiveList<UArch>::q0Unmap() {
   USAGEWARN((!simTock), "query after TOCK");
   USAGEWARN(((dNumReadOld++)<MAX_ACTIVELIST_READOLD), "exceeding number of ActiveList oldmap read (N) port limit\n");
 
+  ASSERT(!UARCH_ROB_RENAME);
   ASSERT(sizeActiveList()<=UARCH_OOO_DEGREE);
 
   UnmapBundle bundle;
@@ -118,9 +222,9 @@ UnmapBundle ActiveList::q0Unmap() {
 
   return bundle;
 }
-#endif
 
-FreeRegBundle ActiveList::q2GetFreeReg() {
+template<class UArch>
+FreeRegBundle ActiveList<UArch>::q2GetFreeReg() {
   USAGEWARN((!simTock), "query after TOCK");
   USAGEWARN(((dNumReadFree++)<MAX_ACTIVELIST_READFREE), "exceeding number of ActiveList free reg read (N) port limit\n");
 
@@ -133,16 +237,16 @@ FreeRegBundle ActiveList::q2GetFreeReg() {
   bundle.howmany=howmany;
     
   for(ULONG i=0, j=mEnqPtr;i<howmany;i++) { 
-#if (UARCH_ROB_RENAME)
-    bundle.free[i].mapped=true;
-    bundle.free[i].idx=(j%(1*UARCH_OOO_DEGREE));
+    if (UARCH_ROB_RENAME) {
+      bundle.free[i].mapped=true;
+      bundle.free[i].idx=(j%(1*UARCH_OOO_DEGREE));
 
-    bundle.atag[i]=(j%(2*UARCH_OOO_DEGREE));
-#else
-    bundle.free[i]=MARRAY(j).tdNew;
+      bundle.atag[i]=(j%(2*UARCH_OOO_DEGREE));
+    } else {
+      bundle.free[i]=MARRAY(j).tdNew;
 
-    bundle.atag[i]=(j%UARCH_OOO_DEGREE);
-#endif
+      bundle.atag[i]=(j%UARCH_OOO_DEGREE);
+    }
     j++;
     j%=(2*UARCH_OOO_DEGREE);
   }
@@ -150,38 +254,33 @@ FreeRegBundle ActiveList::q2GetFreeReg() {
   return bundle;
 }
 
-RetireBundle  ActiveList::q7toRetire() {
+template<class UArch>
+RetireBundle  ActiveList<UArch>::q7toRetire() {
   USAGEWARN((!simTock), "query after TOCK");
   printState();
   
   RetireBundle bundle;
-  ULONG howmany=0;
+  ULONG howmany=numRetirable(mDeqPtr, MIN(UARCH_RETIRE_WIDTH, sizeActiveList()));
   
-#if (UARCH_ROB_RENAME)
-  FOR_RETIRE_WIDTH_i { bundle.td[i].idx=0; }
-#endif
+  if (UARCH_ROB_RENAME) {
+    FOR_RETIRE_WIDTH_i { bundle.td[i].idx=0; }
+  }
 
-  for(ULONG i=0, j=mDeqPtr; i<UARCH_RETIRE_WIDTH; i++) {
-    if (j==mEnqPtr) { 
-      break;
-    }
-    if ((!MARRAY(j).completed)||
-	MARRAY(j).exception) {
-      break;
-    }
+  for(ULONG i=0, j=mDeqPtr; i<howmany; i++) {
+    ASSERT(j!=mEnqPtr);
+    ASSERT(MCOMPLETED(j)&&!MEXCEPTION(j));
 
-#if (UARCH_ROB_RENAME)
-    bundle.rd[i]=MARRAY(j).rd;
-    {
-      RenameTag temp={.mapped=true, .idx=(j%(1*UARCH_OOO_DEGREE))};
-      bundle.td[i]=MARRAY(j).rd?temp:ZeroRegTag;
+    if (UARCH_ROB_RENAME) {
+      bundle.rd[i]=MARRAY(j).rd;
+      {
+	RenameTag temp={.mapped=true, .idx=(j%(1*UARCH_OOO_DEGREE))};
+	bundle.td[i]=MARRAY(j).rd?temp:ZeroRegTag;
+      }
+      bundle.cookie[i]=MARRAY(j).cookie;
+    } else {
+      bundle.td[i]=MARRAY(j).tdOld;
     }
-    bundle.cookie[i]=MARRAY(j).cookie;
-#else
-    bundle.td[i]=MARRAY(j).tdOld;
-#endif
 
-    howmany++;
     j++;
     j%=(2*UARCH_OOO_DEGREE);
   }
@@ -195,13 +294,14 @@ RetireBundle  ActiveList::q7toRetire() {
   return bundle;
 }
 
-bool ActiveList::q0HandleException() {
+template<class UArch>
+bool ActiveList<UArch>::q0HandleException() {
   USAGEWARN((!simTock), "query after TOCK");
   USAGEWARN(((dNumReadStatus++)<MAX_ACTIVELIST_READSTATUS), "exceeding number of ActiveList oldest status read port limit\n");
 
   if (mDeqPtr!=mEnqPtr) {
-    if (MARRAY(mDeqPtr).completed) {
-      if (MARRAY(mDeqPtr).exception) {
+    if (MCOMPLETED(mDeqPtr)) {
+      if (MEXCEPTION(mDeqPtr)) {
 	return true;
       }
     }
@@ -209,99 +309,74 @@ bool ActiveList::q0HandleException() {
   return false;
 }
 
-#if (!UARCH_ROB_RENAME)
-void ActiveList::a0Unmap(ULONG howmany) {
+template<class UArch>
+void ActiveList<UArch>::a0Unmap(ULONG howmany) {
   USAGEWARN(simTock, "action before TOCK");
 
+  ASSERT(!UARCH_ROB_RENAME);
   ASSERT(sizeActiveList()<=UARCH_OOO_DEGREE);
   ASSERT(sizeActiveList()>=howmany);
 
+  if (UARCH_DRIS_CHECKER) {
+    drisUnwind((mEnqPtr-howmany)%(2*UARCH_OOO_DEGREE));
+  }
+
   mEnqPtr-=howmany;
   mEnqPtr%=(2*UARCH_OOO_DEGREE);
 
   ASSERT(sizeActiveList()<=UARCH_OOO_DEGREE);
 }
-#endif
 
-void ActiveList::a2Accept(ULONG howmany, Instruction inst[UARCH_DECODE_WIDTH], ULONG pcLike[UARCH_DECODE_WIDTH], 
-#if (!UARCH_ROB_RENAME)
-    RenameTag tdOld[UARCH_DECODE_WIDTH], 
-#endif
-#if (UARCH_DRIS_CHECKER)
-    RMapBundle renameBndl,
-#endif
-    Cookie cookie[UARCH_DECODE_WIDTH]) {
+template<class UArch>
+void ActiveList<UArch>::a2Accept(ULONG howmany, const Instruction inst[UARCH_MAX_DECODE_WIDTH], const ULONG pcLike[UARCH_MAX_DECODE_WIDTH], 
+    RenameTag tdOld[UARCH_MAX_DECODE_WIDTH], 
+    RMapBundle renameBndl
+    COOKIE_PARAM(cookie[UARCH_MAX_DECODE_WIDTH])) {
   USAGEWARN(simTock, "action before TOCK");
   USAGEWARN(((dNumAccept++)<MAX_ACTIVELIST_ACCEPT), "exceeding number of ActiveList accept write (N) port limit\n");
 
   ASSERT(howmany<=(UARCH_OOO_DEGREE-sizeActiveList()));
 
   for(ULONG i=0, j=mEnqPtr;i<howmany;i++) {
-    MARRAY(j).completed=false;
-    MARRAY(j).exception=false;
+    bitvecClear(mCompleted, j%UARCH_OOO_DEGREE);
+    bitvecClear(mException, j%UARCH_OOO_DEGREE);
     MARRAY(j).pcLike=pcLike[i];
     MARRAY(j).rd=inst[i].rd;
-#if (!UARCH_ROB_RENAME)
-    MARRAY(j).tdOld=tdOld[i];
-#endif
+    if (!UARCH_ROB_RENAME) {
+      MARRAY(j).tdOld=tdOld[i];
+    }
+#if (DEBUG_LEVEL>=DEBUG_SILENT)
     MARRAY(j).cookie=cookie[i];
 
     ASSERT(MARRAY(j).pcLike==
 	   MARRAY(j).cookie.serial);
+#endif
 
-#if (UARCH_DRIS_CHECKER)
-    MARRAY(j).drisRs1=inst[i].rs1;
-    MARRAY(j).drisRs2=inst[i].rs2;
+    if (UARCH_DRIS_CHECKER) {
+      MARRAY(j).drisRs1=inst[i].rs1;
+      MARRAY(j).drisRs2=inst[i].rs2;
 
-    if (inst[i].rd) {
-      MARRAY(j).drisTd.mapped=true;
-      MARRAY(j).drisTd.idx=j;
-    } else {
-      MARRAY(j).drisTd=ZeroRegTag;
-    }
-
-    {
-      MARRAY(j).drisTs1Rdy=true;
-      MARRAY(j).drisTs1.mapped=false;
-      MARRAY(j).drisTs1.idx=inst[i].rs1;
-      MARRAY(j).drisTs2Rdy=true;
-      MARRAY(j).drisTs2.mapped=false;
-      MARRAY(j).drisTs2.idx=inst[i].rs2;
-      
-      if (inst[i].rs1!=R0) {
-	for(ULONG k=j; k!=mDeqPtr; ) {
-	  k--;
-	  k%=2*UARCH_OOO_DEGREE;
-	  if (inst[i].rs1==MARRAY(k).rd) {
-	    MARRAY(j).drisTs1=MARRAY(k).drisTd;
-	    MARRAY(j).drisTs1Rdy=MARRAY(k).drisIssued;  // ready when issued
-	    // since alu 1-cycle
-	    // with forwarding
-	    break;
-	  }
-	}
+      if (inst[i].rd) {
+	MARRAY(j).drisTd.mapped=true;
+	MARRAY(j).drisTd.idx=j;
+      } else {
+	MARRAY(j).drisTd=ZeroRegTag;
       }
 
+      drisLookup(j, 0, inst[i].rs1);
+      drisLookup(j, 1, inst[i].rs2);
 
-      if (inst[i].rs2!=R0) {
-	for(ULONG k=j; k!=mDeqPtr; ) {
-	  k--;
-	  k%=2*UARCH_OOO_DEGREE;
-	  if (inst[i].rs2==MARRAY(k).rd) {
-	    MARRAY(j).drisTs2=MARRAY(k).drisTd;
-	    MARRAY(j).drisTs2Rdy=MARRAY(k).drisIssued;
-	    break;
-	  }
-	}
+      MARRAY(j).drisWaiters=DRIS_NONE;
+      if (inst[i].rd!=R0) {
+	MARRAY(j).drisPrevWriter=mDrisLastWriter[inst[i].rd];
+	mDrisLastWriter[inst[i].rd]=j;
       }
-    }
-    ASSERT(drisTagIdxEqual(MARRAY(j).drisTd,renameBndl.op[i].td));
-    ASSERT(drisTagIdxEqual(MARRAY(j).drisTs1,renameBndl.op[i].ts1));
-    ASSERT(drisTagIdxEqual(MARRAY(j).drisTs2,renameBndl.op[i].ts2));
+      ASSERT(drisTagIdxEqual(MARRAY(j).drisTd,renameBndl.op[i].td));
+      ASSERT(drisTagIdxEqual(MARRAY(j).drisTs1,renameBndl.op[i].ts1));
+      ASSERT(drisTagIdxEqual(MARRAY(j).drisTs2,renameBndl.op[i].ts2));
 
-    MARRAY(j).drisIssued=false;
-
-#endif
+      MARRAY(j).drisIssued=false;
+    }
 
     j++;
     j%=(2*UARCH_OOO_DEGREE);
@@ -311,29 +386,32 @@ void ActiveList::a2Accept(ULONG howmany, Instruction inst[UARCH_DECODE_WIDTH], U
   mEnqPtr%=(2*UARCH_OOO_DEGREE);
 }
 
-void ActiveList::a6Complete(ULONG activeListIdx) {
+template<class UArch>
+void ActiveList<UArch>::a6Complete(ULONG activeListIdx) {
   USAGEWARN(simTock, "action before TOCK");
   USAGEWARN(((dNumComplete++)<MAX_ACTIVELIST_COMPLETE), "exceeding number of ActiveList complete set port limit\n");
 
-  ASSERT(!MARRAY(activeListIdx).completed);
+  ASSERT(!MCOMPLETED(activeListIdx));
 
-  MARRAY(activeListIdx).completed=true;
+  bitvecSet(mCompleted, activeListIdx%UARCH_OOO_DEGREE);
 
-#if (UARCH_DRIS_CHECKER)
-  ASSERT(MARRAY(activeListIdx).drisIssued);
-#endif
+  if (UARCH_DRIS_CHECKER) {
+    ASSERT(MARRAY(activeListIdx).drisIssued);
+  }
 }
 
-void ActiveList::a6Exception(ULONG activeListIdx) {
+template<class UArch>
+void ActiveList<UArch>::a6Exception(ULONG activeListIdx) {
   USAGEWARN(simTock, "action before TOCK");
   USAGEWARN(((dNumExcept++)<MAX_ACTIVELIST_EXCEPT), "exceeding number of ActiveList except set port limit\n");
 
-  ASSERT(!MARRAY(activeListIdx).exception);
+  ASSERT(!MEXCEPTION(activeListIdx));
 
-  MARRAY(activeListIdx).exception=true;
+  bitvecSet(mException, activeListIdx%UARCH_OOO_DEGREE);
 }
 
-void ActiveList::a7Retire(RetireBundle bundle) {
+template<class UArch>
+void ActiveList<UArch>::a7Retire(RetireBundle bundle) {
   USAGEWARN(simTock, "action before TOCK");
   USAGEWARN(((dNumRetire++)<MAX_ACTIVELIST_RETIRE), "exceeding number of ActiveList retire status read (N) port limit\n");
   ASSERT(bundle.howmany<=UARCH_RETIRE_WIDTH);
@@ -341,12 +419,17 @@ void ActiveList::a7Retire(RetireBundle bundle) {
 
   for(ULONG i=0, j=mDeqPtr; i<bundle.howmany; i++) {
     ASSERT(!(j==mEnqPtr));
-    ASSERT(!((!MARRAY(j).completed)||
-	     MARRAY(j).exception==true));
+    ASSERT(MCOMPLETED(j)&&!MEXCEPTION(j));
 
-#if (!UARCH_ROB_RENAME)
-    MARRAY(j).tdNew=bundle.td[i];
-#endif
+    if (!UARCH_ROB_RENAME) {
+      MARRAY(j).tdNew=bundle.td[i];
+    }
+
+    if (UARCH_DRIS_CHECKER) {
+      if ((MARRAY(j).rd!=R0)&&(mDrisLastWriter[MARRAY(j).rd]==j)) {
+	mDrisLastWriter[MARRAY(j).rd]=DRIS_NONE;
+      }
+    }
 
 #if (DEBUG_LEVEL>=DEBUG_FULL)
     prettyPrint(RSTAGE, MARRAY(j).cookie.op, MARRAY(j).cookie);
@@ -361,49 +444,54 @@ void ActiveList::a7Retire(RetireBundle bundle) {
 }
 
 
-#if (!UARCH_ROB_RENAME)
-void ActiveList::a2CheckPoint(ULONG which) {
+template<class UArch>
+void ActiveList<UArch>::a2CheckPoint(ULONG which) {
   USAGEWARN(simTock, "action before TOCK");
 
+  ASSERT(!UARCH_ROB_RENAME);
   ASSERT(which<UARCH_SPECULATE_DEPTH);
 
   mEnqPtrStack[which]=mEnqPtr;
 
   return;
 }
-#endif
  
-#if (UARCH_ROB_RENAME)
-void ActiveList::a6Rewind(ULONG activeListIdx) {
+template<class UArch>
+void ActiveList<UArch>::a6Rewind(ULONG which) {
   USAGEWARN(simTock, "action before TOCK");
 
-  ASSERT(activeListIdx<(2*UARCH_OOO_DEGREE));
+  if (UARCH_ROB_RENAME) {
+    // which is the activeListIdx of the mispredicted branch
+    ASSERT(which<(2*UARCH_OOO_DEGREE));
 
-  activeListIdx++;
-  activeListIdx%=(2*UARCH_OOO_DEGREE);
+    which++;
+    which%=(2*UARCH_OOO_DEGREE);
 
-  mEnqPtr=activeListIdx;
-
-  return;
-}
-#else
-void ActiveList::a6Rewind(ULONG which) {
-  USAGEWARN(simTock, "action before TOCK");
-
-  ASSERT(which<UARCH_SPECULATE_DEPTH);
+    if (UARCH_DRIS_CHECKER) {
+      drisUnwind(which);
+    }
+    mEnqPtr=which;
+  } else {
+    // which is the checkpoint taken by the mispredicted branch
+    ASSERT(which<UARCH_SPECULATE_DEPTH);
 
-  mEnqPtr=mEnqPtrStack[which];
+    if (UARCH_DRIS_CHECKER) {
+      drisUnwind(mEnqPtrStack[which]);
+    }
+    mEnqPtr=mEnqPtrStack[which];
+  }
 
   return;
 }
-#endif
 
-#if (UARCH_DRIS_CHECKER)
-void ActiveList::d4CheckIssue(InstQEntry issue) {
+template<class UArch>
+void ActiveList<UArch>::d4CheckIssue(InstQEntry issue) {
+  ASSERT(UARCH_DRIS_CHECKER);
   ASSERT(issue.valid);
   ASSERT(isOlder(mEnqPtr,issue.atag));
   ASSERT(!isOlder(mDeqPtr,issue.atag));
 
+#if (DEBUG_LEVEL>=DEBUG_SILENT)
   if (isOlder(mDeqPtr,MARRAY(issue.atag).drisTs1.idx)) {
     RenameTag temp={.mapped=false, .idx=MARRAY(issue.atag).drisRs1};
     ASSERT(tagEqual(issue.op.ts1,temp));
@@ -416,50 +504,71 @@ void ActiveList::d4CheckIssue(InstQEntry issue) {
   } else {
     ASSERT(drisTagIdxEqual(issue.op.ts2,MARRAY(issue.atag).drisTs2));
   }
+#endif
   ASSERT(MARRAY(issue.atag).drisTs1Rdy);
   ASSERT(MARRAY(issue.atag).drisTs2Rdy);
 
-  for(ULONG k=mEnqPtr; k!=mDeqPtr; ) {
-    k--;
-    k%=2*UARCH_OOO_DEGREE;
-    if ((MARRAY(issue.atag).rd!=R0) &&
-	tagEqual(MARRAY(issue.atag).drisTd,
-		 MARRAY(k).drisTs1)) {
-      ASSERT(!MARRAY(k).drisTs1Rdy);
-      MARRAY(k).drisTs1Rdy=true;
-    }
-  }
-  for(ULONG k=mEnqPtr; k!=mDeqPtr; ) {
-    k--;
-    k%=2*UARCH_OOO_DEGREE;
-    if ((MARRAY(issue.atag).rd!=R0) &&
-	tagEqual(MARRAY(issue.atag).drisTd,
-		 MARRAY(k).drisTs2)) {
+  // wake up the consumers waiting on this producer
+  for(ULONG link=MARRAY(issue.atag).drisWaiters; link!=DRIS_NONE; ) {
+    ULONG k=link/2;
+
+    ASSERT(MARRAY(issue.atag).rd!=R0);
+    ASSERT(isOlder(mEnqPtr,k));
+    if (link%2) {
+      ASSERT(tagEqual(MARRAY(issue.atag).drisTd, MARRAY(k).drisTs2));
       ASSERT(!MARRAY(k).drisTs2Rdy);
       MARRAY(k).drisTs2Rdy=true;
+    } else {
+      ASSERT(tagEqual(MARRAY(issue.atag).drisTd, MARRAY(k).drisTs1));
+      ASSERT(!MARRAY(k).drisTs1Rdy);
+      MARRAY(k).drisTs1Rdy=true;
     }
+    link=MARRAY(k).drisNextWaiter[link%2];
   }
+  MARRAY(issue.atag).drisWaiters=DRIS_NONE;
 
   ASSERT(!MARRAY(issue.atag).drisIssued);
   MARRAY(issue.atag).drisIssued=true;
 }
-#endif
  
-void ActiveList::rReset() {
+template<class UArch>
+void ActiveList<UArch>::rReset() {
   simTick();
 
-#if (!UARCH_ROB_RENAME)
-  for(ULONG i=0; i<UARCH_OOO_DEGREE; i++) {
-    RenameTag temp={.idx=ARCH_NUM_LOGICAL_REG+i};
-    MARRAY(i).tdNew=temp;
+  if (!UARCH_ROB_RENAME) {
+    for(ULONG i=0; i<UARCH_OOO_DEGREE; i++) {
+      RenameTag temp={.mapped=false, .idx=ARCH_NUM_LOGICAL_REG+i};
+      MARRAY(i).tdNew=temp;
+    }
+  }
+
+  for(ULONG i=0; i<BITVEC_WORDS(UARCH_OOO_DEGREE); i++) {
+    mCompleted[i]=0;
+    mException[i]=0;
+  }
+
+  for(ULONG i=0; i<ARCH_NUM_LOGICAL_REG; i++) {
+    mDrisLastWriter[i]=DRIS_NONE;
   }
-#endif
 
   mEnqPtr=0;
   mDeqPtr=0;
 }
 
-void ActiveList::simTick() {
+template<class UArch>
+void ActiveList<UArch>::rSnapshot(Snapshot *snap) { 
+  SNAP_ARRAY(snap, mArray, UARCH_OOO_DEGREE);
+  SNAP_ARRAY(snap, mCompleted, BITVEC_WORDS(UARCH_OOO_DEGREE));
+  SNAP_ARRAY(snap, mException, BITVEC_WORDS(UARCH_OOO_DEGREE));
+  SNAP_ARRAY(snap, mEnqPtrStack, UARCH_SPECULATE_DEPTH);
+  SNAP(snap, mDrisLastWriter);
+  SNAP(snap, mEnqPtr);
+  SNAP(snap, mDeqPtr);
+}
+
+template<class UArch>
+void ActiveList<UArch>::simTick() {
+#if (DEBUG_LEVEL>=DEBUG_SILENT)
   dNumReadPC=0;
   dNumReadOld=0;
   dNumReadFree=0;
@@ -468,9 +577,11 @@ void ActiveList::simTick() {
   dNumComplete=0;
   dNumExcept=0;
   dNumRetire=0;
+#endif
 }
 
-void ActiveList::printState() {
+template<class UArch>
+void ActiveList<UArch>::printState() {
 #if (DEBUG_LEVEL>=DEBUG_VERBOSE)
   {
     bool printing=false;
@@ -483,7 +594,7 @@ void ActiveList::printState() {
 	cout << "------------------------------------------------------------------------------------\n";
 	printing=true;
       }
-      prettyPrint(":InActLST:", MARRAY(j).cookie.op, MARRAY(j).cookie, "\t\t", MARRAY(j).completed?" completed":"");
+      prettyPrint(":InActLST:", MARRAY(j).cookie.op, MARRAY(j).cookie, "\t\t", MCOMPLETED(j)?" completed":"");
 
       j++;
       j%=(2*UARCH_OOO_DEGREE);
@@ -501,7 +612,13 @@ void ActiveList::printState() {
 //
 ////////////////////////////////////////////////////////
 
-ActiveList::ActiveList() {
+template<class UArch>
+ActiveList<UArch>::ActiveList() {
+  mArray=new ActiveListEntry[UARCH_OOO_DEGREE];
+  mEnqPtrStack=new ULONG[UARCH_SPECULATE_DEPTH];
+  mCompleted=new ULONGLONG[BITVEC_WORDS(UARCH_OOO_DEGREE)];
+  mException=new ULONGLONG[BITVEC_WORDS(UARCH_OOO_DEGREE)];
+
   cout << "MAX_ACTIVELIST_READPC=" << MAX_ACTIVELIST_READPC << "\n";
   cout << "MAX_ACTIVELIST_READOLD=" << MAX_ACTIVELIST_READOLD << "\n";
   cout << "MAX_ACTIVELIST_READFREE=" << MAX_ACTIVELIST_READFREE << "\n";
@@ -514,4 +631,13 @@ ActiveList::ActiveList() {
   rReset();
 }
 
+template<class UArch>
+ActiveList<UArch>::~ActiveList() {
+  delete[] mArray;
+  delete[] mEnqPtrStack;
+  delete[] mCompleted;
+  delete[] mException;
+}
 
+#define INSTANTIATE_ACTIVELIST(U) template class ActiveList<U>;
+UARCH_FOR_EACH(INSTANTIATE_ACTIVELIST)
@@ -26,6 +26,7 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "sim.h"
 #include "arch.h"
 #include "uarch.h"
+#include "snapshot.h"
 #include "magic.h"
 
 #include "regfile.h"
@@ -41,107 +42,101 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define MAX_ACTIVELIST_EXCEPT (UARCH_EXECUTE_WIDTH)
 #define MAX_ACTIVELIST_RETIRE (1)
 
+#define DRIS_NONE (~((ULONG)0))  // null activelist index or waiter link
+
 typedef struct {
   ULONG howmany;
-  RenameTag free[UARCH_DECODE_WIDTH];
-  ULONG atag[UARCH_DECODE_WIDTH];
+  RenameTag free[UARCH_MAX_DECODE_WIDTH];
+  ULONG atag[UARCH_MAX_DECODE_WIDTH];
 } FreeRegBundle;
 
-#if (!UARCH_ROB_RENAME)
+// only used if !UARCH_ROB_RENAME
 typedef struct {
   ULONG howmany;
-  RenameTag tdOld[UARCH_DECODE_WIDTH];
-  LogicalRegName rd[UARCH_DECODE_WIDTH];
+  RenameTag tdOld[UARCH_MAX_DECODE_WIDTH];
+  LogicalRegName rd[UARCH_MAX_DECODE_WIDTH];
 } UnmapBundle;
-#endif
 
 typedef struct {
   ULONG pcLike;
-  bool completed;
-  bool exception;
   LogicalRegName rd;
-#if (UARCH_DRIS_CHECKER)
+  // if UARCH_DRIS_CHECKER: 
   // DRIS combines ROB, RS, and rename functionalities into one
   // centralized data structure. This is based on Metaflow Lightning
   // DRIS. This is only used as a checker in this project.
   LogicalRegName drisRs1, drisRs2;
   RenameTag drisTd, drisTs1, drisTs2;
   bool drisIssued, drisTs1Rdy, drisTs2Rdy;
-#endif
-#if (!UARCH_ROB_RENAME)
+  ULONG drisPrevWriter;     // last writer of rd when this was accepted
+  ULONG drisWaiters;        // list of consumers not yet drisTsXRdy on drisTd
+  ULONG drisProducer[2];    // activelist index of drisTs1, drisTs2 producer 
+  ULONG drisNextWaiter[2];  // next in drisProducer[]'s list
+  // a waiter link is (2*activelist index)+(0 for drisTs1; 1 for drisTs2)
+  // if !UARCH_ROB_RENAME:
   RenameTag tdNew; // this is the "freelist"
   RenameTag tdOld; // need this to unwind on exception
-#endif
   Cookie cookie;
 } ActiveListEntry;
 
 typedef struct {
   ULONG howmany;
-  RenameTag td[UARCH_RETIRE_WIDTH];
-#if (UARCH_ROB_RENAME)
-  LogicalRegName rd[UARCH_RETIRE_WIDTH];
-  DataValue val[UARCH_RETIRE_WIDTH];
-  Cookie cookie[UARCH_RETIRE_WIDTH];
-#endif
+  RenameTag td[UARCH_MAX_RETIRE_WIDTH];
+  // only used if UARCH_ROB_RENAME
+  LogicalRegName rd[UARCH_MAX_RETIRE_WIDTH];
+  DataValue val[UARCH_MAX_RETIRE_WIDTH];
+  Cookie cookie[UARCH_MAX_RETIRE_WIDTH];
 } RetireBundle;
 
+template<class UArch>
 class ActiveList {
  public:
-#if (!UARCH_ROB_RENAME)
-  UnmapBundle q0Unmap();
-#endif
+  UnmapBundle q0Unmap();  // !UARCH_ROB_RENAME only
   bool q0HandleException();
+  bool q0Empty();         // nothing inflight
   ULONG q0GetPC(ULONG activeListIdx);
   ULONG q0GetExceptionPC();
   
   FreeRegBundle q2GetFreeReg();
 
-#if (!UARCH_ROB_RENAME)
-  void a0Unmap(ULONG howmany);
-#endif
+  void a0Unmap(ULONG howmany);  // !UARCH_ROB_RENAME only
 
   RetireBundle q7toRetire();
 
   void a2Accept(ULONG howmany, 
-		Instruction inst[UARCH_DECODE_WIDTH], ULONG pcLike[UARCH_DECODE_WIDTH],
-#if (!UARCH_ROB_RENAME)
-		RenameTag tdOld[UARCH_DECODE_WIDTH],
-#endif
-#if (UARCH_DRIS_CHECKER)
-		RMapBundle renameBndl,
-#endif
-		Cookie cookie[UARCH_DECODE_WIDTH]);
-  void a2CheckPoint(ULONG which);
+		const Instruction inst[UARCH_MAX_DECODE_WIDTH], const ULONG pcLike[UARCH_MAX_DECODE_WIDTH],
+		RenameTag tdOld[UARCH_MAX_DECODE_WIDTH], // ignored if UARCH_ROB_RENAME
+		RMapBundle renameBndl                    // ignored if !UARCH_DRIS_CHECKER
+		COOKIE_PARAM(cookie[UARCH_MAX_DECODE_WIDTH]));
+  void a2CheckPoint(ULONG which);  // !UARCH_ROB_RENAME only
   
   void a6Complete(ULONG activeListIdx);
   void a6Exception(ULONG activeListIdx);
-#if (UARCH_ROB_RENAME)
-  void a6Rewind(ULONG activeListIdx);
-#else
-  void a6Rewind(ULONG which);
-#endif
+  void a6Rewind(ULONG which);  // activeListIdx of the branch if
+			      // UARCH_ROB_RENAME; else its checkpoint
 
   void a7Retire(RetireBundle bundle);
   
-#if (UARCH_DRIS_CHECKER)
-  void d4CheckIssue(InstQEntry issue);
-#endif
+  void d4CheckIssue(InstQEntry issue);  // UARCH_DRIS_CHECKER only
   
   void rReset();
+  void rSnapshot(Snapshot *snap);  // save or restore all state
 
   void simTick();
 
   // Constructor
   ActiveList();
+  ~ActiveList();
 
  private:
-  ActiveListEntry mArray[UARCH_OOO_DEGREE];
-#if (!UARCH_ROB_RENAME)
-  ULONG mEnqPtrStack[UARCH_SPECULATE_DEPTH];
-#endif
+  ActiveListEntry *mArray;  // UARCH_OOO_DEGREE entries
+  ULONGLONG *mCompleted;    // status bits of mArray entries, 
+  ULONGLONG *mException;    // BITVEC_WORDS(UARCH_OOO_DEGREE)
+  ULONG *mEnqPtrStack;      // UARCH_SPECULATE_DEPTH entries; !UARCH_ROB_RENAME only
+  ULONG mDrisLastWriter[ARCH_NUM_LOGICAL_REG];  // UARCH_DRIS_CHECKER only
   ULONG mEnqPtr;
   ULONG mDeqPtr;
 
+#if (DEBUG_LEVEL>=DEBUG_SILENT)
   ULONG dNumReadPC;
   ULONG dNumReadOld;
   ULONG dNumReadFree;
@@ -150,9 +145,13 @@ class ActiveList {
   ULONG dNumComplete;
   ULONG dNumExcept;
   ULONG dNumRetire;
+#endif
 
   ULONG sizeActiveList();
+  ULONG numRetirable(ULONG from, ULONG limit);
   bool isOlder(ULONG young, ULONG old);
+  void drisLookup(ULONG j, ULONG which, LogicalRegName rs);
+  void drisUnwind(ULONG enqPtr);
   void printState();
 };
 
@@ -35,7 +35,7 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //
 ////////////////////////////////////////////////////////
 
-AluOut Alu::q6Execute( bool valid, Operation op, ULONG vs1, ULONG vs2, Cookie cookie) {
+AluOut Alu::q6Execute( bool valid, Operation op, ULONG vs1, ULONG vs2 COOKIE_PARAM(cookie)) {
   AluOut result;
 
   result.vd=vs1+vs2;
@@ -37,7 +37,7 @@ typedef struct {
 class Alu {
  public:
   
-  AluOut q6Execute(bool doIt, Operation op, ULONG vs1, ULONG vs2, Cookie cookie);
+  AluOut q6Execute(bool doIt, Operation op, ULONG vs1, ULONG vs2 COOKIE_PARAM(cookie));
 
   void rReset();
 
@@ -90,11 +90,17 @@ void Busy::rReset() {
 
   return; 
 }                      
+void Busy::rSnapshot(Snapshot *snap) { 
+  SNAP_ARRAY(snap, mArray, UARCH_NUM_PHYSICAL_REG);
+}
+
 void Busy::simTick() { 
 
+#if (DEBUG_LEVEL>=DEBUG_SILENT)
   dNumRead=0;
   dNumSet=0;
   dNumClear=0;
+#endif
 
   return; 
 }                      
@@ -105,6 +111,8 @@ void Busy::simTick() {
 //
 ////////////////////////////////////////////////////////
 Busy::Busy() {
+  mArray=new bool[UARCH_NUM_PHYSICAL_REG];
+
   cout << "MAX_BUSY_READ=" << MAX_BUSY_READ << "\n";
   cout << "MAX_BUSY_SET=" << MAX_BUSY_SET << "\n";
   cout << "MAX_BUSY_CLEAR=" << MAX_BUSY_CLEAR << "\n";
@@ -112,4 +120,8 @@ Busy::Busy() {
   rReset();
 }
 
+Busy::~Busy() {
+  delete[] mArray;
+}
+
 
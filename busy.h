@@ -26,6 +26,7 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "sim.h"
 #include "arch.h"
 #include "uarch.h"
+#include "snapshot.h"
 
 #define MAX_BUSY_READ (UARCH_DECODE_WIDTH*2)
 #define MAX_BUSY_SET (UARCH_DECODE_WIDTH)
@@ -43,17 +44,21 @@ class Busy {
   void a4ClearBusy(PhysicalRegIdx preg);
 
   void rReset();
+  void rSnapshot(Snapshot *snap);  // save or restore all state
 
   void simTick();
 
   // Constructor
   Busy();
+  ~Busy();
 
  private:
-  bool mArray[UARCH_NUM_PHYSICAL_REG];
+  bool *mArray;  // UARCH_NUM_PHYSICAL_REG entries
+#if (DEBUG_LEVEL>=DEBUG_SILENT)
   ULONG dNumRead; 
   ULONG dNumSet; 
   ULONG dNumClear; 
+#endif
 };
 
 #endif
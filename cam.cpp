@@ -0,0 +1,288 @@
+#define CAM_CPP
+/*********************************************************************
+Copyright 2019 James C. Hoe
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+#include "sim.h"
+#include "cam.h"
+#include "rng.h"
+
+#if (defined(__x86_64__)||defined(__i386__))
+#include <immintrin.h>
+#define CAM_X86 (1)
+#else
+#define CAM_X86 (0)
+#endif
+
+////////////////////////////////////////////////////////
+//
+// scalar reference
+//
+////////////////////////////////////////////////////////
+
+static void camMatchEqualScalar(const UINT *keys, ULONG n, UINT key, ULONGLONG *O_Match) {
+  ASSERT((n%CAM_WORD_BITS)==0);
+
+  for(ULONG w=0; w<n/CAM_WORD_BITS; w++) {
+    ULONGLONG match=0;
+    for(ULONG i=0; i<CAM_WORD_BITS; i++) {
+      match|=((ULONGLONG)(keys[w*CAM_WORD_BITS+i]==key))<<i;
+    }
+    O_Match[w]=match;
+  }
+}
+
+static void camMatchAnyScalar(const ULONGLONG *keys, ULONG n, ULONGLONG key, ULONGLONG *O_Match) {
+  ASSERT((n%CAM_WORD_BITS)==0);
+
+  for(ULONG w=0; w<n/CAM_WORD_BITS; w++) {
+    ULONGLONG match=0;
+    for(ULONG i=0; i<CAM_WORD_BITS; i++) {
+      match|=((ULONGLONG)((keys[w*CAM_WORD_BITS+i]&key)!=0))<<i;
+    }
+    O_Match[w]=match;
+  }
+}
+
+#if CAM_X86
+
+////////////////////////////////////////////////////////
+//
+// SSE4: 4 tags or 2 masks per compare
+//
+////////////////////////////////////////////////////////
+
+__attribute__((target("sse4.1")))
+static void camMatchEqualSSE4(const UINT *keys, ULONG n, UINT key, ULONGLONG *O_Match) {
+  const __m128i k=_mm_set1_epi32((INT)key);
+
+  for(ULONG w=0; w<n/CAM_WORD_BITS; w++) {
+    ULONGLONG match=0;
+    for(ULONG i=0; i<CAM_WORD_BITS; i+=4) {
+      __m128i v=_mm_loadu_si128((const __m128i*)(keys+w*CAM_WORD_BITS+i));
+      ULONGLONG bits=_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v,k)));
+      match|=bits<<i;
+    }
+    O_Match[w]=match;
+  }
+}
+
+__attribute__((target("sse4.1")))
+static void camMatchAnySSE4(const ULONGLONG *keys, ULONG n, ULONGLONG key, ULONGLONG *O_Match) {
+  const __m128i k=_mm_set1_epi64x((LONGLONG)key);
+  const __m128i zero=_mm_setzero_si128();
+
+  for(ULONG w=0; w<n/CAM_WORD_BITS; w++) {
+    ULONGLONG none=0;
+    for(ULONG i=0; i<CAM_WORD_BITS; i+=2) {
+      __m128i v=_mm_loadu_si128((const __m128i*)(keys+w*CAM_WORD_BITS+i));
+      ULONGLONG bits=_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(_mm_and_si128(v,k),zero)));
+      none|=bits<<i;
+    }
+    O_Match[w]=~none;
+  }
+}
+
+////////////////////////////////////////////////////////
+//
+// AVX2: 8 tags or 4 masks per compare
+//
+////////////////////////////////////////////////////////
+
+__attribute__((target("avx2")))
+static void camMatchEqualAVX2(const UINT *keys, ULONG n, UINT key, ULONGLONG *O_Match) {
+  const __m256i k=_mm256_set1_epi32((INT)key);
+
+  for(ULONG w=0; w<n/CAM_WORD_BITS; w++) {
+    ULONGLONG match=0;
+    for(ULONG i=0; i<CAM_WORD_BITS; i+=8) {
+      __m256i v=_mm256_loadu_si256((const __m256i*)(keys+w*CAM_WORD_BITS+i));
+      ULONGLONG bits=_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v,k)));
+      match|=bits<<i;
+    }
+    O_Match[w]=match;
+  }
+}
+
+__attribute__((target("avx2")))
+static void camMatchAnyAVX2(const ULONGLONG *keys, ULONG n, ULONGLONG key, ULONGLONG *O_Match) {
+  const __m256i k=_mm256_set1_epi64x((LONGLONG)key);
+  const __m256i zero=_mm256_setzero_si256();
+
+  for(ULONG w=0; w<n/CAM_WORD_BITS; w++) {
+    ULONGLONG none=0;
+    for(ULONG i=0; i<CAM_WORD_BITS; i+=4) {
+      __m256i v=_mm256_loadu_si256((const __m256i*)(keys+w*CAM_WORD_BITS+i));
+      ULONGLONG bits=_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(v,k),zero)));
+      none|=bits<<i;
+    }
+    O_Match[w]=~none;
+  }
+}
+
+#endif
+
+////////////////////////////////////////////////////////
+//
+// startup selection
+//
+////////////////////////////////////////////////////////
+
+typedef enum { CAM_SCALAR, CAM_SSE4, CAM_AVX2 } CamKernel;
+
+static CamKernel camDetect() {
+#if CAM_X86
+  if (CAM_SIMD) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+      return CAM_AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+      return CAM_SSE4;
+    }
+  }
+#endif
+  return CAM_SCALAR;
+}
+
+static const CamKernel camKernel=camDetect();
+
+#if CAM_X86
+void (*camMatchEqual)(const UINT*, ULONG, UINT, ULONGLONG*)=
+  (camKernel==CAM_AVX2)?camMatchEqualAVX2:
+  (camKernel==CAM_SSE4)?camMatchEqualSSE4:
+  camMatchEqualScalar;
+void (*camMatchAny)(const ULONGLONG*, ULONG, ULONGLONG, ULONGLONG*)=
+  (camKernel==CAM_AVX2)?camMatchAnyAVX2:
+  (camKernel==CAM_SSE4)?camMatchAnySSE4:
+  camMatchAnyScalar;
+#else
+void (*camMatchEqual)(const UINT*, ULONG, UINT, ULONGLONG*)=camMatchEqualScalar;
+void (*camMatchAny)(const ULONGLONG*, ULONG, ULONGLONG, ULONGLONG*)=camMatchAnyScalar;
+#endif
+
+const char *camKernelName() {
+  return (camKernel==CAM_AVX2)?"avx2":(camKernel==CAM_SSE4)?"sse4":"scalar";
+}
+
+////////////////////////////////////////////////////////
+//
+// self-check
+//
+////////////////////////////////////////////////////////
+
+typedef struct {
+  const char *name;
+  bool supported;
+  void (*matchEqual)(const UINT*, ULONG, UINT, ULONGLONG*);
+  void (*matchAny)(const ULONGLONG*, ULONG, ULONGLONG, ULONGLONG*);
+  bool good;
+} CamCheckKernel;
+
+#define CAM_CHECK_MAX_WORDS (8)
+
+// mostly a few bits, as the instq's dependOn masks and checkpoint
+// masks are, sometimes none or all of them
+static ULONGLONG camCheckMask(Rng *rng) {
+  switch(rng->getNext()%8) {
+  case 0: return 0;
+  case 1: return ~0ULL;
+  case 2: return rng->getNext();
+  default: return 1ULL<<(rng->getNext()%64);
+  }
+}
+
+bool camCheck(ULONG rounds, ULONG seed) {
+  CamCheckKernel kernels[]={
+#if CAM_X86
+    { "avx2", __builtin_cpu_supports("avx2")!=0, camMatchEqualAVX2, camMatchAnyAVX2, true },
+    { "sse4", __builtin_cpu_supports("sse4.1")!=0, camMatchEqualSSE4, camMatchAnySSE4, true },
+#endif
+    { "scalar", true, camMatchEqualScalar, camMatchAnyScalar, true },
+  };
+  // one spare entry, to also search from an unaligned start
+  UINT tags[CAM_CHECK_MAX_WORDS*CAM_WORD_BITS+1];
+  ULONGLONG masks[CAM_CHECK_MAX_WORDS*CAM_WORD_BITS+1];
+  ULONGLONG expect[CAM_CHECK_MAX_WORDS];
+  ULONGLONG match[CAM_CHECK_MAX_WORDS];
+  bool good=true;
+  Rng rng;
+
+#if CAM_X86
+  __builtin_cpu_init();
+#endif
+  rng.rSeed(seed);
+
+  for(ULONG round=0; round<rounds; round++) {
+    ULONG words=1+rng.getNext()%CAM_CHECK_MAX_WORDS;
+    ULONG n=words*CAM_WORD_BITS;
+    ULONG offset=rng.getNext()%2;
+    // a small tag range, so that keys match now and then
+    ULONG range=(rng.getNext()%2)?((ULONG)~0U):(1+rng.getNext()%(2*n));
+
+    for(ULONG i=0; i<(n+1); i++) {
+      tags[i]=(UINT)((range==(ULONG)~0U)?rng.getNext():(rng.getNext()%range));
+      masks[i]=camCheckMask(&rng);
+    }
+    UINT tag=(UINT)((range==(ULONG)~0U)?rng.getNext():(rng.getNext()%range));
+    ULONGLONG mask=camCheckMask(&rng);
+
+    for(ULONG k=0; k<(sizeof(kernels)/sizeof(kernels[0])); k++) {
+      if (!kernels[k].supported) {
+	continue;
+      }
+
+      camMatchEqualScalar(tags+offset, n, tag, expect);
+      kernels[k].matchEqual(tags+offset, n, tag, match);
+      for(ULONG w=0; w<words; w++) {
+	if ((match[w]!=expect[w])&&kernels[k].good) {
+	  // the first difference only
+	  cerr << "cam: " << kernels[k].name << " match-equal differs in round " << round 
+	       << ", word " << w << " of " << words << "\n";
+	  kernels[k].good=false;
+	}
+      }
+
+      camMatchAnyScalar(masks+offset, n, mask, expect);
+      kernels[k].matchAny(masks+offset, n, mask, match);
+      for(ULONG w=0; w<words; w++) {
+	if ((match[w]!=expect[w])&&kernels[k].good) {
+	  // the first difference only
+	  cerr << "cam: " << kernels[k].name << " match-any differs in round " << round 
+	       << ", word " << w << " of " << words << "\n";
+	  kernels[k].good=false;
+	}
+      }
+    }
+  }
+
+  for(ULONG k=0; k<(sizeof(kernels)/sizeof(kernels[0])); k++) {
+    good=good&&kernels[k].good;
+    cout << "cam: " << kernels[k].name << " " 
+	 << ((!kernels[k].supported)?"not supported by this host":
+	     (kernels[k].matchEqual==camMatchEqualScalar)?"reference":
+	     kernels[k].good?"matches scalar":"FAILED")
+	 << ((kernels[k].matchEqual==camMatchEqual)?" (in use)":"") << "\n";
+  }
+
+  return good;
+}
@@ -0,0 +1,53 @@
+#ifndef CAM_H
+#define CAM_H
+/*********************************************************************
+Copyright 2019 James C. Hoe
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+#include "sim.h"
+
+//
+// Match kernels for emulating CAM searches over packed key arrays.
+// Each kernel compares n entries (n a multiple of 64; callers pad
+// their arrays) against a broadcast key and sets bit i of O_Match for
+// each matching entry i.  An AVX2 or SSE4 implementation is chosen at
+// startup by CPUID; the scalar ones are the reference.  CAM_SIMD set
+// to 0 forces the scalar kernels.
+//
+#define CAM_SIMD (1)
+#define CAM_WORD_BITS (64)
+
+// key[i]==key 
+extern void (*camMatchEqual)(const UINT *keys, ULONG n, UINT key, ULONGLONG *O_Match);
+// (keys[i]&key)!=0
+extern void (*camMatchAny)(const ULONGLONG *keys, ULONG n, ULONGLONG key, ULONGLONG *O_Match);
+
+const char *camKernelName();  // "avx2", "sse4" or "scalar"
+
+//
+// Compare every kernel this host can run against the scalar ones over
+// rounds of random keys, search keys and sizes; reports the first
+// mismatch of each on cerr.  See ooo-camcheck (camcheck.cpp).
+//
+bool camCheck(ULONG rounds, ULONG seed);
+
+#endif
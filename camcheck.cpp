@@ -0,0 +1,62 @@
+#define CAMCHECK_CPP
+/*********************************************************************
+Copyright 2019 James C. Hoe
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+
+#include <cstring>
+#include <cstdlib>
+
+#include "sim.h"
+#include "cam.h"
+
+/*
+ * ooo-camcheck runs the SIMD match kernels of cam.h that this host
+ * supports side by side with the scalar reference and exits with 1 if
+ * any result differs.
+ *
+ *    ooo-camcheck [rounds [seed]]
+ */
+
+#define CAMCHECK_ROUNDS (20000)
+
+static void usage(const char *prog) {
+  cerr << "usage: " << prog << " [rounds [seed]]\n";
+}
+
+int main(int argc, char *argv[]) {
+  ULONG rounds=CAMCHECK_ROUNDS;
+  ULONG seed=1;
+
+  if ((argc>3)||((argc>1)&&((!strcmp(argv[1], "-h"))||(!strcmp(argv[1], "--help"))))) {
+    usage(argv[0]);
+    return (argc>3)?1:0;
+  }
+  if (argc>1) {
+    rounds=strtoul(argv[1], NULL, 0);
+  }
+  if (argc>2) {
+    seed=strtoul(argv[2], NULL, 0);
+  }
+
+  return camCheck(rounds, seed)?0:1;
+}
@@ -28,84 +28,29 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "checkpoint.h"
 
-bool dependOnSpeculation(SpeculateMask mask, SpeculateMask spec) {
-  bool dependOn=false;
-
-  FOR_SPECULATE_DEPTH_i {
-    if ((mask.bit[i])&&(spec.bit[i])) {
-      dependOn=true;
-    }
-  }
-
-  return dependOn;
-}   
-
-bool dependOnSpeculation(SpeculateMask mask, ULONG spec) {
-  return mask.bit[spec];
-}
-
-
-bool maskIsSetSpeculation(SpeculateMask spec) {
-  bool isSet=false;
-
-  FOR_SPECULATE_DEPTH_i {
-    if (spec.bit[i]) {
-      isSet=true;
-    }
-  }
-
-  return isSet;
-}   
-
-ULONG whichSpeculation(SpeculateMask spec) {
-  ASSERT(maskIsSetOnceSpeculation(spec));
-  ULONG which=0;
-
-  FOR_SPECULATE_DEPTH_i {
-    if (spec.bit[i]) {
-      which=i;
-    }
-  }
-
-  return which;
-}
-
-bool maskIsSetOnceSpeculation(SpeculateMask spec) {
-  ULONG isSet=0;
-
-  FOR_SPECULATE_DEPTH_i {
-    if (spec.bit[i]) {
-      isSet++;
-    }
-  }
-
-  return (isSet==1);
-}   
-
-bool Checkpoint::q2HasFree() {
+template<class UArch>
+bool Checkpoint<UArch>::q2HasFree() {
   USAGEWARN((!simTock), "query after TOCK");
 
   return (mNumInuse<UARCH_SPECULATE_DEPTH);
 }
 
-ULONG Checkpoint::q2NextFree() {
+template<class UArch>
+ULONG Checkpoint<UArch>::q2NextFree() {
   USAGEWARN((!simTock), "query after TOCK");
 
   ASSERT(mNumInuse<UARCH_SPECULATE_DEPTH);
 
-  ULONG next;
+  // lowest free slot
+  ULONG next=__builtin_ctzll(~mInuse.bits);
 
-  for(next=0; next<UARCH_SPECULATE_DEPTH; next++) {
-    if (mInuse.bit[next]==false) {
-      break;
-    }
-  }
   ASSERT(next<UARCH_SPECULATE_DEPTH);
   
   return next;
 }
 
-SpeculateMask Checkpoint::q0GetMask() {
+template<class UArch>
+SpeculateMask Checkpoint<UArch>::q0GetMask() {
   USAGEWARN((!simTock), "query after TOCK");
 
   SpeculateMask mask=mInuse;
@@ -114,14 +59,15 @@ SpeculateMask Checkpoint::q0GetMask() {
 }
 
 
-SpeculateMask Checkpoint::q0Ground() {
+template<class UArch>
+SpeculateMask Checkpoint<UArch>::q0Ground() {
   USAGEWARN((!simTock), "query after TOCK");
-  SpeculateMask mask;
-  FOR_SPECULATE_DEPTH_i { mask.bit[i]=false; }
+  SpeculateMask mask=ZeroSpeculateMask;
 
-  FOR_SPECULATE_DEPTH_i {
-    if (mInuse.bit[i]&&(!maskIsSetSpeculation(mDependOn[i]))) {
-      mask.bit[i]=true;
+  for(ULONGLONG inuse=mInuse.bits; inuse; inuse&=(inuse-1)) {
+    ULONG i=__builtin_ctzll(inuse);
+    if (!maskIsSetSpeculation(mDependOn[i])) {
+      setSpeculation(&mask, i);
     }
   }
 
@@ -133,87 +79,79 @@ SpeculateMask Checkpoint::q0Ground() {
   return mask;
 }
 
-void Checkpoint::a2New(ULONG next) {
+template<class UArch>
+void Checkpoint<UArch>::a2New(ULONG next) {
   USAGEWARN(simTock, "action before TOCK");
 
   ASSERT(mNumInuse<UARCH_SPECULATE_DEPTH);
   ASSERT(next<UARCH_SPECULATE_DEPTH);
-  ASSERT(mInuse.bit[next]==false);
+  ASSERT(!dependOnSpeculation(mInuse, next));
 
   mDependOn[next]=mInuse;
-  mInuse.bit[next]=true;
+  setSpeculation(&mInuse, next);
   mNumInuse++;
 }
 
-void Checkpoint::a6Free(SpeculateMask mask) {
+template<class UArch>
+void Checkpoint<UArch>::a6Free(SpeculateMask mask) {
   USAGEWARN(simTock, "action before TOCK");
 
   ASSERT(mNumInuse>=1);
   ASSERT(maskIsSetOnceSpeculation(mask));
 
-  {
-    FOR_SPECULATE_DEPTH_i {
-      if (mask.bit[i]) {
-	ASSERT(mInuse.bit[i]);
-	mInuse.bit[i]=false;
-      }
-    }
-  }
+  ASSERT(dependOnSpeculation(mInuse, mask));
+  clearSpeculation(&mInuse, mask);
   ASSERT(mNumInuse>=1);
   mNumInuse--;
 
-  {
-    FOR_SPECULATE_DEPTH_i {
-      if (mInuse.bit[i]) { // okay to not check this
-	FOR_SPECULATE_DEPTH_j {
-	  if ((mDependOn[i].bit[j]) && mask.bit[j]) {
-	    mDependOn[i].bit[j]=false;
-	  }
-	}
-      }
-    }
+  for(ULONGLONG inuse=mInuse.bits; inuse; inuse&=(inuse-1)) {
+    clearSpeculation(&mDependOn[__builtin_ctzll(inuse)], mask);
   }
 }
 
-void Checkpoint::a6Rewind(SpeculateMask mask) {
+template<class UArch>
+void Checkpoint<UArch>::a6Rewind(SpeculateMask mask) {
   USAGEWARN(simTock, "action before TOCK");
 
   ASSERT(mNumInuse>0);
   ASSERT(maskIsSetOnceSpeculation(mask));
 
-  FOR_SPECULATE_DEPTH_i {
-    if (mInuse.bit[i]) { // okay to not check this
-      ASSERT(mNumInuse>=1);
+  for(ULONGLONG inuse=mInuse.bits; inuse; inuse&=(inuse-1)) {
+    ULONG i=__builtin_ctzll(inuse);
+    ASSERT(mNumInuse>=1);
       
-      if(dependOnSpeculation(mDependOn[i],mask)) {
-	mInuse.bit[i]=false;
-	mNumInuse--;
-	ASSERT(mNumInuse>=1);
-      }
+    if(dependOnSpeculation(mDependOn[i],mask)) {
+      // younger than the rewinding branch
+      mInuse.bits&=~(((ULONGLONG)1)<<i);
+      mNumInuse--;
+      ASSERT(mNumInuse>=1);
     }
   }
 
-  FOR_SPECULATE_DEPTH_i {
-    if (mask.bit[i]) {
-      ASSERT(mInuse.bit[i]);
-      mInuse.bit[i]=false;
-    }
-  }
+  ASSERT(dependOnSpeculation(mInuse, mask));
+  clearSpeculation(&mInuse, mask);
   ASSERT(mNumInuse>=1);
   mNumInuse--;
 }
 
-void Checkpoint::rReset() {
+template<class UArch>
+void Checkpoint<UArch>::rReset() {
   simTick();
 
-  FOR_SPECULATE_DEPTH_i {
-    mInuse.bit[i]=false;
-  }
+  mInuse=ZeroSpeculateMask;
 
   mNumInuse=0;
 }
 
-void Checkpoint::simTick() {
+template<class UArch>
+void Checkpoint<UArch>::rSnapshot(Snapshot *snap) { 
+  SNAP(snap, mInuse);
+  SNAP_ARRAY(snap, mDependOn, UARCH_SPECULATE_DEPTH);
+  SNAP(snap, mNumInuse);
+}
+
+template<class UArch>
+void Checkpoint<UArch>::simTick() {
 }
 
 ////////////////////////////////////////////////////////
@@ -221,9 +159,19 @@ void Checkpoint::simTick() {
 // Constructors
 //
 ////////////////////////////////////////////////////////
-Checkpoint::Checkpoint() {
+template<class UArch>
+Checkpoint<UArch>::Checkpoint() {
+  mDependOn=new SpeculateMask[UARCH_SPECULATE_DEPTH];
+
   cout << "RESET_CHKPT=" << RESET_CHKPT << "\n";
 
   rReset();
 }
 
+template<class UArch>
+Checkpoint<UArch>::~Checkpoint() {
+  delete[] mDependOn;
+}
+
+#define INSTANTIATE_CHECKPOINT(U) template class Checkpoint<U>;
+UARCH_FOR_EACH(INSTANTIATE_CHECKPOINT)
@@ -26,15 +26,47 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "sim.h"
 #include "arch.h"
 #include "uarch.h"
+#include "snapshot.h"
 
 #define RESET_CHKPT (0)
 
-bool dependOnSpeculation(SpeculateMask mask, SpeculateMask spec);
-bool dependOnSpeculation(SpeculateMask mask, ULONG spec);
-bool maskIsSetSpeculation(SpeculateMask spec);
-bool maskIsSetOnceSpeculation(SpeculateMask spec);
-ULONG whichSpeculation(SpeculateMask spec);
+//
+// SpeculateMask operations
+//
+static inline bool dependOnSpeculation(SpeculateMask mask, SpeculateMask spec) {
+  return (mask.bits&spec.bits)!=0;
+}
 
+static inline bool dependOnSpeculation(SpeculateMask mask, ULONG spec) {
+  return (mask.bits>>spec)&1;
+}
+
+static inline bool maskIsSetSpeculation(SpeculateMask spec) {
+  return spec.bits!=0;
+}
+
+static inline bool maskIsSetOnceSpeculation(SpeculateMask spec) {
+  return (spec.bits!=0)&&((spec.bits&(spec.bits-1))==0);
+}
+
+static inline ULONG countSpeculation(SpeculateMask spec) {
+  return __builtin_popcountll(spec.bits);
+}
+
+static inline ULONG whichSpeculation(SpeculateMask spec) {
+  ASSERT(maskIsSetOnceSpeculation(spec));
+  return __builtin_ctzll(spec.bits);
+}
+
+static inline void setSpeculation(SpeculateMask *mask, ULONG which) {
+  mask->bits|=(((ULONGLONG)1)<<which);
+}
+
+static inline void clearSpeculation(SpeculateMask *mask, SpeculateMask spec) {
+  mask->bits&=~spec.bits;
+}
+
+template<class UArch>
 class Checkpoint {
  public:
 
@@ -50,15 +82,17 @@ class Checkpoint {
   void a6Rewind(SpeculateMask);
 
   void rReset();
+  void rSnapshot(Snapshot *snap);  // save or restore all state
 
   void simTick();
 
   // Constructor
   Checkpoint();
+  ~Checkpoint();
 
 private:
   SpeculateMask mInuse;
-  SpeculateMask mDependOn[UARCH_SPECULATE_DEPTH];
+  SpeculateMask *mDependOn;  // UARCH_SPECULATE_DEPTH entries
   ULONG mNumInuse;
 };
 
@@ -0,0 +1,340 @@
+#define CONFIG_CPP
+/*********************************************************************
+Copyright 2019 James C. Hoe
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+#include <cstring>
+#include <cstddef>
+#include <cctype>
+#include <fstream>
+#include <string>
+
+#include "sim.h"
+#include "arch.h"
+#include "uarch.h"
+#include "trace.h"
+
+#include "config.h"
+
+thread_local UArchConfig uarchConfig;  // datapath configuration in effect
+thread_local TraceConfig traceConfig;  // trace configuration in effect
+
+typedef struct {
+  const char *name;
+  size_t offset;  // of the ULONG field in SimConfig
+  ULONG min, max;
+} ConfigParam;
+
+#define CONFIG_PARAM(name, field, min, max) { name, offsetof(SimConfig, field), min, max }
+
+static const ConfigParam configParam[]={
+  CONFIG_PARAM("UARCH_USE_BASELINE", uarch.useBaseline, 0, 1),
+  CONFIG_PARAM("UARCH_ROB_RENAME", uarch.robRename, 0, 1),
+  CONFIG_PARAM("UARCH_CASCADE_ISSUE4_OPRND5", uarch.cascadeIssue4Oprnd5, 0, 1),
+  CONFIG_PARAM("UARCH_DECODE_WIDTH", uarch.decodeWidth, 1, UARCH_MAX_DECODE_WIDTH),
+  CONFIG_PARAM("UARCH_RETIRE_WIDTH", uarch.retireWidth, 1, UARCH_MAX_RETIRE_WIDTH),
+  CONFIG_PARAM("UARCH_EXECUTE_WIDTH", uarch.executeWidth, 1, UARCH_MAX_EXECUTE_WIDTH),
+  CONFIG_PARAM("UARCH_OOO_DEGREE", uarch.oooDegree, 1, (1<<20)),
+  CONFIG_PARAM("UARCH_INSTQ_SIZE", uarch.instqSize, 1, (1<<20)),
+  CONFIG_PARAM("UARCH_SPECULATE_DEPTH", uarch.speculateDepth, 1, UARCH_MAX_SPECULATE_DEPTH),
+
+  CONFIG_PARAM("TRACE_RANDOM", trace.random, 0, 1),
+  CONFIG_PARAM("TRACE_USE_BASELINE", trace.useBaseline, 0, 1),
+  CONFIG_PARAM("TRACE_WITH_R0", trace.withR0, 0, 1),
+  CONFIG_PARAM("TRACE_RNAME_RANGE", trace.rnameRange, 1, ARCH_NUM_LOGICAL_REG),
+  CONFIG_PARAM("TRACE_DRIFT_DIV", trace.driftDiv, 1, ~0UL),
+  CONFIG_PARAM("TRACE_DRIFT_MUL", trace.driftMul, 0, ~0UL),
+  CONFIG_PARAM("TRACE_LENGTH", trace.length, 0, ~0UL),
+  CONFIG_PARAM("TRACE_ADD_SHARE", trace.addShare, 0, ~0UL),
+  CONFIG_PARAM("TRACE_BR_SHARE", trace.brShare, 0, ~0UL),
+  CONFIG_PARAM("TRACE_BR_HIT", trace.brHit, 0, ~0UL),
+  CONFIG_PARAM("TRACE_BR_MISS", trace.brMiss, 0, ~0UL),
+  CONFIG_PARAM("TRACE_EXCEPT", trace.except, 0, ~0UL),
+  CONFIG_PARAM("TRACE_EXCEPT_TOTAL", trace.exceptTotal, 1, ~0UL),
+  CONFIG_PARAM("TRACE_SEED", trace.seed, 0, ~0UL),
+};
+
+#define NUM_CONFIG_PARAM (sizeof(configParam)/sizeof(ConfigParam))
+
+static const ConfigParam configOptionParam[]={
+  CONFIG_PARAM("--fast-forward", fastForward, 0, ~0UL),
+  CONFIG_PARAM("--sample-period", samplePeriod, 0, ~0UL),
+  CONFIG_PARAM("--sample-warmup", sampleWarmup, 0, ~0UL),
+  CONFIG_PARAM("--sample-window", sampleWindow, 1, ~0UL),
+  CONFIG_PARAM("--save-at", saveAt, 0, ~0UL),
+  CONFIG_PARAM("--producer", producer, 0, 2),
+};
+
+#define NUM_CONFIG_OPTION (sizeof(configOptionParam)/sizeof(ConfigParam))
+
+typedef struct {
+  const char *name;
+  size_t offset;  // of the char[CONFIG_MAX_FILENAME] field in SimConfig
+} ConfigFileParam;
+
+static const ConfigFileParam configFileParam[]={
+  { "--save", offsetof(SimConfig, saveFile) },
+  { "--restore", offsetof(SimConfig, restoreFile) },
+  { "--trace", offsetof(SimConfig, trace.file) },
+  { "--record", offsetof(SimConfig, recordFile) },
+  { "--replay", offsetof(SimConfig, replayFile) },
+};
+
+#define NUM_CONFIG_FILE (sizeof(configFileParam)/sizeof(ConfigFileParam))
+
+static ULONG *configField(SimConfig *config, const ConfigParam *param) {
+  return (ULONG*)(((char*)config)+param->offset);
+}
+
+static void configPresetUArch(UArchConfig *uarch) {
+  if (uarch->useBaseline) {
+    uarch->decodeWidth=UARCH_BASELINE_DECODE_WIDTH;
+    uarch->retireWidth=UARCH_BASELINE_RETIRE_WIDTH;
+    uarch->executeWidth=UARCH_BASELINE_EXECUTE_WIDTH;
+    uarch->oooDegree=UARCH_BASELINE_OOO_DEGREE;
+    uarch->instqSize=UARCH_BASELINE_INSTQ_SIZE;
+    uarch->speculateDepth=UARCH_BASELINE_SPECULATE_DEPTH;
+  } else {
+    uarch->decodeWidth=UARCH_HACKING_DECODE_WIDTH;
+    uarch->retireWidth=UARCH_HACKING_RETIRE_WIDTH;
+    uarch->executeWidth=UARCH_HACKING_EXECUTE_WIDTH;
+    uarch->oooDegree=UARCH_HACKING_OOO_DEGREE;
+    uarch->instqSize=UARCH_HACKING_INSTQ_SIZE;
+    uarch->speculateDepth=UARCH_HACKING_SPECULATE_DEPTH;
+  }
+}
+
+static void configPresetTrace(TraceConfig *trace) {
+  if (trace->useBaseline) {
+    trace->withR0=TRACE_BASELINE_WITH_R0;
+    trace->rnameRange=TRACE_BASELINE_RNAME_RANGE;
+    trace->driftDiv=TRACE_BASELINE_DRIFT_DIV;
+    trace->driftMul=TRACE_BASELINE_DRIFT_MUL;
+    trace->length=TRACE_BASELINE_LENGTH;
+    trace->addShare=TRACE_BASELINE_ADD_SHARE;
+    trace->brShare=TRACE_BASELINE_BR_SHARE;
+    trace->brHit=TRACE_BASELINE_BR_HIT;
+    trace->brMiss=TRACE_BASELINE_BR_MISS;
+    trace->except=TRACE_BASELINE_EXCEPT;
+    trace->exceptTotal=TRACE_BASELINE_EXCEPT_TOTAL;
+  } else {
+    trace->withR0=TRACE_HACKING_WITH_R0;
+    trace->rnameRange=TRACE_HACKING_RNAME_RANGE;
+    trace->driftDiv=TRACE_HACKING_DRIFT_DIV;
+    trace->driftMul=TRACE_HACKING_DRIFT_MUL;
+    trace->length=TRACE_HACKING_LENGTH;
+    trace->addShare=TRACE_HACKING_ADD_SHARE;
+    trace->brShare=TRACE_HACKING_BR_SHARE;
+    trace->brHit=TRACE_HACKING_BR_HIT;
+    trace->brMiss=TRACE_HACKING_BR_MISS;
+    trace->except=TRACE_HACKING_EXCEPT;
+    trace->exceptTotal=TRACE_HACKING_EXCEPT_TOTAL;
+  }
+}
+
+void configDefault(SimConfig *config) {
+  config->uarch.useBaseline=UARCH_DEFAULT_USE_BASELINE;
+  config->uarch.robRename=UARCH_DEFAULT_ROB_RENAME;
+  config->uarch.cascadeIssue4Oprnd5=UARCH_DEFAULT_CASCADE_ISSUE4_OPRND5;
+  configPresetUArch(&config->uarch);
+
+  config->trace.random=TRACE_DEFAULT_RANDOM;
+  config->trace.useBaseline=TRACE_DEFAULT_USE_BASELINE;
+  config->trace.seed=TRACE_DEFAULT_SEED;
+  configPresetTrace(&config->trace);
+  memset(config->trace.file, 0, sizeof(config->trace.file));
+
+  config->fastForward=0;
+  config->samplePeriod=0;
+  config->sampleWarmup=CONFIG_DEFAULT_SAMPLE_WARMUP;
+  config->sampleWindow=CONFIG_DEFAULT_SAMPLE_WINDOW;
+  memset(config->saveFile, 0, sizeof(config->saveFile));
+  config->saveAt=0;
+  memset(config->restoreFile, 0, sizeof(config->restoreFile));
+  memset(config->recordFile, 0, sizeof(config->recordFile));
+  memset(config->replayFile, 0, sizeof(config->replayFile));
+  config->producer=CONFIG_DEFAULT_PRODUCER;
+}
+
+static bool configSet(SimConfig *config, const ConfigParam *param, const char *value) {
+  char *end;
+  ULONG val=strtoul(value, &end, 0);
+
+  if ((*value=='\0')||(*end!='\0')||(*value=='-')) {
+    cerr << "config: " << param->name << " expects an unsigned integer, got \"" << value << "\"\n";
+    return false;
+  }
+  if ((val<param->min)||(val>param->max)) {
+    cerr << "config: " << param->name << "=" << val << " is outside of [" 
+	 << param->min << "," << param->max << "]\n";
+    return false;
+  }
+
+  *configField(config, param)=val;
+  return true;
+}
+
+bool configAssign(SimConfig *config, const char *assignment) {
+  const char *eq=strchr(assignment, '=');
+
+  if (!eq) {
+    cerr << "config: expecting NAME=VALUE, got \"" << assignment << "\"\n";
+    return false;
+  }
+
+  std::string name(assignment, eq-assignment);
+  const char *value=eq+1;
+
+  for(ULONG i=0; i<NUM_CONFIG_PARAM; i++) {
+    if (name==configParam[i].name) {
+      if (!configSet(config, &configParam[i], value)) {
+	return false;
+      }
+
+      // presets overwrite the second-order parameters
+      if (name=="UARCH_USE_BASELINE") {
+	configPresetUArch(&config->uarch);
+      } 
+      if (name=="TRACE_USE_BASELINE") {
+	configPresetTrace(&config->trace);
+      } 
+      return true;
+    }
+  }
+
+  cerr << "config: unknown parameter " << name << "\n";
+  return false;
+}
+
+bool configIsOption(const char *arg) {
+  for(ULONG i=0; i<NUM_CONFIG_OPTION; i++) {
+    if (!strcmp(arg, configOptionParam[i].name)) {
+      return true;
+    }
+  }
+  for(ULONG i=0; i<NUM_CONFIG_FILE; i++) {
+    if (!strcmp(arg, configFileParam[i].name)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool configOption(SimConfig *config, const char *option, const char *value) {
+  for(ULONG i=0; i<NUM_CONFIG_OPTION; i++) {
+    if (!strcmp(option, configOptionParam[i].name)) {
+      return configSet(config, &configOptionParam[i], value);
+    }
+  }
+  for(ULONG i=0; i<NUM_CONFIG_FILE; i++) {
+    if (!strcmp(option, configFileParam[i].name)) {
+      if ((*value=='\0')||(strlen(value)>=CONFIG_MAX_FILENAME)) {
+	cerr << "config: " << option << " expects a file name shorter than " 
+	     << CONFIG_MAX_FILENAME << ", got \"" << value << "\"\n";
+	return false;
+      }
+      strncpy(((char*)config)+configFileParam[i].offset, value, CONFIG_MAX_FILENAME);
+      return true;
+    }
+  }
+
+  cerr << "config: unknown option " << option << "\n";
+  return false;
+}
+
+bool configLoad(SimConfig *config, const char *filename) {
+  std::ifstream file(filename);
+
+  if (!file) {
+    cerr << "config: cannot open " << filename << "\n";
+    return false;
+  }
+
+  std::string line;
+  ULONG lineNum=0;
+
+  while(std::getline(file, line)) {
+    lineNum++;
+
+    // strip comment and whitespaces
+    size_t hash=line.find('#');
+    if (hash!=std::string::npos) {
+      line.erase(hash);
+    }
+    std::string stripped;
+    for(size_t i=0; i<line.size(); i++) {
+      if (!isspace((unsigned char)line[i])) {
+	stripped+=line[i];
+      }
+    }
+    if (stripped.empty()) {
+      continue;
+    }
+
+    if (!configAssign(config, stripped.c_str())) {
+      cerr << "config: ... at " << filename << ":" << lineNum << "\n";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool configCheck(const SimConfig *config) {
+  const UArchConfig *uarch=&config->uarch;
+  const TraceConfig *trace=&config->trace;
+
+  // the activelist/instq ring arithmetic only wraps right on powers of two
+  if (!isTwoPower(uarch->oooDegree)) {
+    cerr << "config: UARCH_OOO_DEGREE must be a power of two\n";
+    return false;
+  }
+  if (!isTwoPower(uarch->instqSize)) {
+    cerr << "config: UARCH_INSTQ_SIZE must be a power of two\n";
+    return false;
+  }
+
+  if ((trace->addShare+trace->brShare)==0) {
+    cerr << "config: TRACE_ADD_SHARE+TRACE_BR_SHARE must be non-zero\n";
+    return false;
+  }
+  if ((trace->brHit+trace->brMiss)==0) {
+    cerr << "config: TRACE_BR_HIT+TRACE_BR_MISS must be non-zero\n";
+    return false;
+  }
+  if (config->samplePeriod&&
+      (config->samplePeriod<(config->sampleWarmup+config->sampleWindow))) {
+    cerr << "config: --sample-period must cover --sample-warmup plus --sample-window\n";
+    return false;
+  }
+  if (config->recordFile[0]&&config->replayFile[0]) {
+    cerr << "config: --record and --replay do not go together\n";
+    return false;
+  }
+  if ((config->recordFile[0]||config->replayFile[0])&&
+      (config->fastForward||config->samplePeriod||config->saveFile[0]||config->restoreFile[0])) {
+    cerr << "config: --record and --replay do not go with --fast-forward, --sample-period, --save or --restore\n";
+    return false;
+  }
+
+  return true;
+}
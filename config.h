@@ -0,0 +1,108 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+/*********************************************************************
+Copyright 2019 James C. Hoe
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+#include "sim.h"
+#include "arch.h"
+#include "uarch.h"
+#include "trace.h"
+
+/*
+ * A complete simulation configuration.  Parameters are named by the
+ * same UARCH_* and TRACE_* names printed at startup and are set by
+ * NAME=VALUE assignments, either one per line in a config file ('#'
+ * starts a comment) or on the command line, e.g.,
+ *
+ *    ooo -c r10k.cfg UARCH_INSTQ_SIZE=32 TRACE_LENGTH=1000000
+ *
+ * TRACE_SEED, printed only if set, selects the random trace
+ * generator (see trace.h).
+ *
+ * Assignments are applied in order.  UARCH_USE_BASELINE and
+ * TRACE_USE_BASELINE load the corresponding preset of second-order
+ * parameters from uarch.h and trace.h, so they should come before
+ * any individual overrides.
+ *
+ * Run-control options are given on the command line as "--option
+ * VALUE":
+ *
+ *    --fast-forward N   the first N trace instructions are executed
+ *                       by Magic only; detailed simulation starts
+ *                       from the architectural state they leave
+ *    --sample-period N  sampled simulation: every N instructions,
+ *                       a detailed window of
+ *    --sample-warmup N  N unmeasured instructions, then
+ *    --sample-window N  N measured instructions; the rest of the
+ *                       period is executed by Magic only
+ *    --save FILE        once --save-at N instructions have been
+ *    --save-at N        accepted, drain the datapath and snapshot
+ *                       the simulation into FILE, then go on
+ *    --restore FILE     start from a snapshot instead of reset; a
+ *                       snapshot of another UARCH_* configuration
+ *                       only carries over the architectural state
+ *    --trace FILE       read a binary trace (see tracefile.h), or
+ *                       "-" for stdin, instead of generating one
+ *                       or using test.h
+ *    --record FILE      write the fetched stream, wrong path and
+ *                       redirects included, to FILE (see fetchrec.h)
+ *    --replay FILE      feed the datapath from a recording instead
+ *                       of Trace and Magic
+ *    --producer N       run Trace and Magic on a thread of their own
+ *                       ahead of the datapath (see fetch.h): 0 never,
+ *                       1 if the host has more than 1 hardware thread
+ *                       (default), 2 always; results are the same
+ *
+ * --record and --replay cover a whole run from reset, so they do not
+ * go with --fast-forward, --sample-period, --save or --restore.
+ */
+#define CONFIG_DEFAULT_SAMPLE_WARMUP (2000)
+#define CONFIG_DEFAULT_SAMPLE_WINDOW (1000)
+#define CONFIG_MAX_FILENAME (TRACE_MAX_FILENAME)
+#define CONFIG_DEFAULT_PRODUCER (1)
+
+typedef struct {
+  UArchConfig uarch;
+  TraceConfig trace;
+  ULONG fastForward;    // leading trace instructions run by Magic alone
+  ULONG samplePeriod;   // 0 if not sampling
+  ULONG sampleWarmup;
+  ULONG sampleWindow;
+  char saveFile[CONFIG_MAX_FILENAME];     // empty if not saving
+  ULONG saveAt;
+  char restoreFile[CONFIG_MAX_FILENAME];  // empty if not restoring
+  char recordFile[CONFIG_MAX_FILENAME];   // empty if not recording
+  char replayFile[CONFIG_MAX_FILENAME];   // empty if not replaying
+  ULONG producer;       // FETCH_PRODUCER_*
+} SimConfig;
+
+void configDefault(SimConfig *config);
+
+bool configAssign(SimConfig *config, const char *assignment);
+bool configLoad(SimConfig *config, const char *filename);
+bool configIsOption(const char *arg);
+bool configOption(SimConfig *config, const char *option, const char *value);
+
+bool configCheck(const SimConfig *config);
+
+#endif
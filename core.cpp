@@ -0,0 +1,461 @@
+#define CORE_CPP
+/*********************************************************************
+Copyright 2019 James C. Hoe
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+
+#include "sim.h"
+#include "arch.h"
+#include "uarch.h"
+#include "config.h"
+
+#include "core.h"
+#include "datapath.h"
+
+static thread_local const Core *coreInstalled=NULL;  // whose config is in effect on this thread
+
+void Core::install(const SimConfig *config) {
+  uarchConfig=config->uarch;
+  traceConfig=config->trace;
+  coreInstalled=NULL;
+}
+
+void Core::install() {
+  if (coreInstalled!=this) {
+    install(&mConfig);
+    coreInstalled=this;
+  }
+  simTimer=mTimer;
+}
+
+Core *Core::create(const SimConfig *config) {
+  // objects size themselves by the configuration in effect
+  install(config);
+
+#define CORE_MATCH(U) if (U::matches(&config->uarch)) { return new Datapath<U>(config); }
+  UARCH_FOR_EACH(CORE_MATCH)
+
+  ASSERT(0); // UArchRuntime matches everything
+  return NULL;
+}
+
+bool Core::qDone() {
+  return mDone;
+}
+
+bool Core::qFailed() {
+  return mFetch.qFailed();
+}
+
+ULONG Core::qCycle() {
+  return mStats.cycles;
+}
+
+ULONG Core::qInstCount() {
+  return mStats.insts;
+}
+
+CoreStats Core::qStats() {
+  return mStats;
+}
+
+//
+// 1 cycle of fetch and datapath, short of advancing time; returns
+// the datapath horizon
+//
+ULONG Core::step(ULONG *O_Offered) {
+  FetchBundle fetchedInsts;
+  ULONG accept;
+  bool rewind;
+  bool restart;
+  ULONG gotoPC;
+  ULONG horizon;
+
+  fetchedInsts=mFetch.qGetInsts();
+
+  datapath(false, fetchedInsts, &accept, &rewind, &restart, &gotoPC, &horizon );
+  mStats.insts+=accept;
+    
+  mFetch.aAccept(accept);
+  if (rewind) {
+    ASSERT(!restart);
+    mFetch.aRewind(gotoPC);
+    mStats.rewinds++;
+  }
+  if (restart) {
+    ASSERT(!rewind);
+    mFetch.aRestart(gotoPC);
+    mStats.restarts++;
+  }
+
+  *O_Offered=fetchedInsts.howmany;
+  return horizon;
+}
+
+bool Core::aCycle() {
+  ULONG offered;
+  ULONG horizon;
+  bool waiting;
+
+  if (mDone) {
+    return false;
+  }
+
+  install();
+
+  waiting=mFetch.qWaiting();
+  horizon=step(&offered);
+
+  if (offered==0) {
+    mStats.stallFetch++;
+    // a replay waiting on a redirect still has instructions, unless
+    // nothing is left inflight to make it
+    if (((!waiting)||(horizon==DATAPATH_HORIZON_NEVER))&&
+	((--mCountdown)==0)) {
+      // give the datapath time to drain 
+      mDone=true;
+      return false;
+    }
+  }
+
+  // advance time
+  mTimer+=TICK_CYC;
+  mStats.cycles++;
+
+  if (CORE_SKIP_IDLE&&(offered==0)&&horizon) {
+    // Fetch stays dry once it came up empty without a redirect, so
+    // the next cycles would only count down; take all but the last
+    // of them at once.
+    ULONG skip=MIN(horizon, mCountdown-1);
+
+    mStats.stallFetch+=skip;
+    mCountdown-=skip;
+    mTimer+=skip*TICK_CYC;
+    mStats.cycles+=skip;
+  }
+
+  return true;
+}
+
+// simulate until n more instructions are accepted; false once done
+bool Core::detailed(ULONG n) {
+  ULONG start=mStats.insts;
+
+  while((mStats.insts-start)<n) {
+    if (!aCycle()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// hold fetch and simulate until nothing is inflight
+void Core::drain() {
+  ULONG offered;
+  ULONG horizon;
+
+  mFetch.aHold(true);
+  do {
+    horizon=step(&offered);
+    mTimer+=TICK_CYC;
+    mStats.cycles++;
+  } while(horizon!=DATAPATH_HORIZON_NEVER);
+  mFetch.aHold(false);
+}
+
+// start the empty datapath from Magic's architectural state
+void Core::seed() {
+  DataValue archRF[ARCH_NUM_LOGICAL_REG];
+
+  for(ULONG i=0; i<ARCH_NUM_LOGICAL_REG; i++) {
+    archRF[i]=mFetch.qArchReg((LogicalRegName)i);
+  }
+  rSeed(archRF);
+}
+
+bool Core::aSample() {
+  ULONG skip=mConfig.samplePeriod-mConfig.sampleWarmup-mConfig.sampleWindow;
+  ULONG cycles;
+  ULONG insts;
+  double cpi;
+
+  if (mDone) {
+    return false;
+  }
+
+  install();
+
+  if (skip) {
+    ULONG taken=mFetch.aFastForward(skip);
+
+    mStats.fastForward+=taken;
+    if (taken<skip) {
+      // the trace ran out
+      mDone=true;
+      return false;
+    }
+    seed();
+  }
+
+  if (!detailed(mConfig.sampleWarmup)) {
+    return false;
+  }
+
+  cycles=mStats.cycles;
+  insts=mStats.insts;
+  if (!detailed(mConfig.sampleWindow)) {
+    // a window cut short by the end of the trace is not counted
+    return false;
+  }
+  cpi=((double)(mStats.cycles-cycles))/(mStats.insts-insts);
+
+  mStats.windows++;
+  mStats.windowCPI+=cpi;
+  mStats.windowCPISq+=cpi*cpi;
+
+  drain();
+
+  return true;
+}
+
+void Core::aFastForward(ULONG n) {
+  install();
+
+  mStats.fastForward+=mFetch.aFastForward(n);
+  seed();
+}
+
+//
+// Snapshot file layout: header, Fetch (trace, Magic), Core, datapath
+//
+#define SNAPSHOT_MAGIC "ooosnap"
+#define SNAPSHOT_VERSION (5)
+
+typedef struct {
+  char magic[8];
+  ULONG version;
+  ULONG debugLevel;   // of the build that saved it
+  ULONG cookieBytes;  // sizeof(Cookie); state carries Cookies and
+		      // DRIS checking only at DEBUG_SILENT and above
+  UArchConfig uarch;
+  TraceConfig trace;
+} SnapshotHeader;
+
+void Core::snapshot(Snapshot *snap) {
+  SNAP(snap, mTimer);
+  SNAP(snap, mStats);
+  SNAP(snap, mCountdown);
+  SNAP(snap, mDone);
+  rSnapshot(snap);
+}
+
+bool Core::aSave(const char *filename) {
+  Snapshot snap(filename, true);
+  SnapshotHeader header;
+
+  install();
+  drain();
+
+  memset(&header, 0, sizeof(header));
+  strcpy(header.magic, SNAPSHOT_MAGIC);
+  header.version=SNAPSHOT_VERSION;
+  header.debugLevel=DEBUG_LEVEL;
+  header.cookieBytes=sizeof(Cookie);
+  header.uarch=mConfig.uarch;
+  header.trace=mConfig.trace;
+
+  SNAP(&snap, header);
+  mFetch.rSnapshot(&snap);
+  snapshot(&snap);
+
+  snap.aClose();
+  return snap.qGood();
+}
+
+bool Core::rRestore(const char *filename) {
+  Snapshot snap(filename, false);
+  SnapshotHeader header;
+
+  install();
+
+  SNAP(&snap, header);
+  if (!snap.qGood()) {
+    return false;
+  }
+  if (strncmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic))||
+      (header.version!=SNAPSHOT_VERSION)) {
+    snap.aFail("not a snapshot of this simulator version");
+    return false;
+  }
+  if (header.cookieBytes!=sizeof(Cookie)) {
+    char why[128];
+
+    snprintf(why, sizeof(why), "saved by a DEBUG_LEVEL=%lu build, whose state does not "
+	     "load into this DEBUG_LEVEL=%d one", header.debugLevel, DEBUG_LEVEL);
+    snap.aFail(why);
+    return false;
+  }
+  // the trace file itself may have been moved or piped in
+  if (memcmp(&header.trace, &mConfig.trace, offsetof(TraceConfig, file))||
+      ((!header.trace.file[0])!=(!mConfig.trace.file[0]))) {
+    snap.aFail("saved under another TRACE_* configuration");
+    return false;
+  }
+
+  mFetch.rSnapshot(&snap);
+  if (!memcmp(&header.uarch, &mConfig.uarch, sizeof(UArchConfig))) {
+    snapshot(&snap);
+  } else {
+    // saved drained, so Magic holds the architectural state
+    seed();
+  }
+
+  snap.aClose();
+  if (!snap.qGood()) {
+    // part of the state is already overwritten
+    rReset();
+    return false;
+  }
+  return true;
+}
+
+bool Core::aRecord(const char *filename) {
+  install();
+  return mFetch.aRecord(filename);
+}
+
+bool Core::aReplay(const char *filename) {
+  install();
+  return mFetch.aReplay(filename);
+}
+
+void Core::rReset() {
+  FetchBundle nothing={.howmany=0};
+  ULONG accept;
+  bool rewind;
+  bool restart;
+  ULONG gotoPC;
+  ULONG horizon;
+
+  mTimer=0;
+  memset(&mStats, 0, sizeof(mStats));
+  mDone=false;
+
+  install();
+
+  mCountdown=UARCH_OOO_DEGREE*2;
+
+  mFetch.rReset();
+  datapath(true, nothing, &accept, &rewind, &restart, &gotoPC, &horizon );
+}
+
+// run a simulation to completion
+CoreStats coreRun(const SimConfig *config) {
+  Core *core=Core::create(config);
+  CoreStats stats;
+  bool failed=false;
+
+  bool saving=(config->saveFile[0]!='\0');
+
+  core->rReset();
+  if (config->restoreFile[0]&&(!core->rRestore(config->restoreFile))) {
+    failed=true;
+  }
+  if ((!failed)&&config->fastForward) {
+    core->aFastForward(config->fastForward);
+  }
+  if ((!failed)&&
+      ((config->recordFile[0]&&(!core->aRecord(config->recordFile)))||
+       (config->replayFile[0]&&(!core->aReplay(config->replayFile))))) {
+    failed=true;
+  }
+
+  while(!failed) {
+    if (saving&&(core->qInstCount()>=config->saveAt)) {
+      if (!core->aSave(config->saveFile)) {
+	failed=true;
+	break;
+      }
+      saving=false;
+    }
+    if (!(config->samplePeriod?core->aSample():core->aCycle())) {
+      break;
+    }
+  }
+
+  if (saving&&(!failed)) {
+    cerr << "snapshot: " << config->saveFile << " not saved; the trace ran out before --save-at\n";
+  }
+
+  stats=core->qStats();
+  stats.failed=failed||core->qFailed();
+  delete core;
+
+  return stats;
+}
+
+//
+// IPC estimated as the inverse of the mean CPI of the sampled
+// windows, with the confidence interval of that mean mapped over;
+// false if there are too few windows for an interval
+//
+bool coreEstimateIPC(const CoreStats *stats, double *ipc, double *low, double *high) {
+  ULONG n=stats->windows;
+
+  ASSERT(n);
+
+  double mean=stats->windowCPI/n;
+
+  *ipc=1.0/mean;
+  if (n<2) {
+    return false;
+  }
+
+  double var=MAX(0.0, (stats->windowCPISq-n*mean*mean)/(n-1));
+  double half=CORE_SAMPLE_Z*sqrt(var/n);
+
+  *low=1.0/(mean+half);
+  *high=(mean>half)?(1.0/(mean-half)):HUGE_VAL;
+
+  return true;
+}
+
+////////////////////////////////////////////////////////
+//
+// Constructors
+//
+////////////////////////////////////////////////////////
+Core::Core(const SimConfig *config) : 
+  mStats(), mConfig(*config), mTimer(0), mCountdown(0), mDone(false) {
+  // mFetch is constructed under the configuration installed by create()
+  mFetch.aProducer(config->producer);
+}
+
+Core::~Core() {
+  if (coreInstalled==this) {
+    coreInstalled=NULL;
+  }
+}
@@ -0,0 +1,185 @@
+#ifndef CORE_H
+#define CORE_H
+/*********************************************************************
+Copyright 2019 James C. Hoe
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+
+#include "sim.h"
+#include "arch.h"
+#include "uarch.h"
+#include "config.h"
+
+#include "fetch.h"
+#include "snapshot.h"
+
+/*
+ * A Core is one complete, independent simulation: a Fetch front-end
+ * (trace and magic) driving an out-of-order datapath, plus the
+ * simulation time and configuration they run under.  Any number of
+ * Cores can coexist in a process, and Cores on different threads run
+ * independently.
+ *
+ * simTimer, simTock, uarchConfig and traceConfig are per-thread and
+ * describe the Core currently being simulated on that thread.  A Core
+ * installs its own values before it constructs its objects and
+ * before every cycle, so Cores sharing a thread can be interleaved
+ * cycle by cycle.
+ *
+ * Core::create() returns the datapath instance compiled for the
+ * configuration (see UARCH_FOR_EACH in uarch.h).  coreRun() runs one
+ * complete simulation from reset until the trace is drained.  A file
+ * that cannot be read or written ends the run early with
+ * CoreStats.failed set, rather than the process, so that the other
+ * runs of a sweep carry on.
+ *
+ * A sampled simulation (--sample-period) instead calls aSample()
+ * once per period: Magic alone executes up to the next window, which
+ * is seeded into an empty datapath, warmed up and then measured in
+ * detail, after which fetch is held until the datapath drains.
+ * coreEstimateIPC() turns the windows' cycles per instruction into
+ * an IPC estimate and its confidence interval.
+ *
+ * aSave() snapshots a Core at a drained point: nothing is inflight
+ * and Magic is not speculating.  rRestore() resumes exactly from a
+ * snapshot of the same UARCH_* configuration; for any other, only
+ * the trace position and Magic's architectural state are taken and
+ * seeded into the reset datapath, with statistics starting over.
+ * The TRACE_* configuration must match either way.
+ *
+ * aRecord() and aReplay() make Fetch write out, or feed back, the
+ * exact fetched stream of a run (see fetchrec.h), so that backend
+ * changes can be compared on one recorded front-end run.
+ */
+
+//
+// Statistics of a simulation.  A decode stall cycle is one where
+// fetch had instructions ready but the datapath accepted fewer than
+// it could have; each is charged to the first limiting resource.
+//
+typedef struct {
+  ULONG cycles;           // cycles simulated
+  ULONG insts;            // instructions accepted into the datapath
+  ULONG stallFetch;       // no instruction offered by fetch
+  ULONG stallActiveList;  // activelist (and free registers) full
+  ULONG stallInstQ;       // instruction queues full
+  ULONG stallBranch;      // decode stopped at a branch: 1 per cycle,
+			  // ALU0 instq or rewind stack full
+  ULONG stallException;   // pending exception holds decode
+  ULONG rewinds;          // branch mispredict redirects
+  ULONG restarts;         // exception restarts
+  ULONG fastForward;      // instructions run by Magic alone; not in
+			  // insts
+  ULONG windows;          // sampled windows measured
+  double windowCPI;       // sum over the sampled windows of cycles
+  double windowCPISq;     // per instruction, and of its square
+  bool failed;            // coreRun() gave up on an input or output
+			  // file; the rest covers the run up to there
+} CoreStats;
+
+//
+// z of the confidence interval reported for sampled simulation
+//
+#define CORE_SAMPLE_Z (1.96)
+#define CORE_SAMPLE_CONFIDENCE "95%"
+
+
+#define DATAPATH_HORIZON_NEVER (~0UL)
+
+//
+// Skip over cycles in which neither fetch nor the datapath can
+// change state (e.g., draining after the trace ran out), charging
+// them to statistics as if they were simulated
+//
+#define CORE_SKIP_IDLE (1)
+
+class Core {
+ public:
+  static Core *create(const SimConfig *config);
+
+  bool qDone();         // drained after the trace ran out
+  bool qFailed();       // the trace or replay could not be read
+  ULONG qCycle();       // cycles simulated since reset
+  ULONG qInstCount();   // instructions accepted into the datapath
+  CoreStats qStats();
+
+  bool aCycle();        // simulate 1 cycle; false once done
+  bool aSample();       // simulate 1 sampling period; false once done
+  void aFastForward(ULONG n);  // by Magic alone; datapath drained
+
+  bool aSave(const char *filename);     // drains the datapath first
+  bool rRestore(const char *filename);  // after rReset(); reset again if false
+  bool aRecord(const char *filename);   // after rReset()
+  bool aReplay(const char *filename);   // after rReset()
+
+  void rReset();
+
+  virtual ~Core();
+
+ protected:
+  Core(const SimConfig *config);
+
+  //
+  // One invocation corresponds to 1 cycle of the out-of-order
+  // datapath; see datapath.h.  *O_0Horizon is the number of cycles
+  // following this one in which the datapath cannot change state
+  // unless fetch offers instructions; DATAPATH_HORIZON_NEVER if it
+  // is quiescent.
+  //
+  virtual void datapath(bool I_Reset, FetchBundle I_2FetchedInsts, 
+			ULONG *O_2Accept, bool *O_6Rewind, bool *O_0Restart, ULONG *O_0GotoPC,
+			ULONG *O_0Horizon)=0;
+
+  //
+  // Load architectural register values into an empty datapath, as
+  // left by a fast-forward
+  //
+  virtual void rSeed(const DataValue archRF[ARCH_NUM_LOGICAL_REG])=0;
+
+  // save or restore all datapath state
+  virtual void rSnapshot(Snapshot *snap)=0;
+
+  CoreStats mStats;  // stall counters are updated by datapath()
+
+ private:
+  SimConfig mConfig;
+  Tick mTimer;
+
+  Fetch mFetch;
+
+  ULONG mCountdown;
+  bool mDone;
+
+  static void install(const SimConfig *config);
+  void install();
+
+  void snapshot(Snapshot *snap);
+  ULONG step(ULONG *O_Offered);
+  bool detailed(ULONG n);
+  void drain();
+  void seed();
+};
+
+CoreStats coreRun(const SimConfig *config);
+bool coreEstimateIPC(const CoreStats *stats, double *ipc, double *low, double *high);
+
+#endif
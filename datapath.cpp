@@ -30,18 +30,6 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "datapath.h"
 
-//
-// Datapath Objects
-//
-#include "activelist.h"
-#include "alu.h"
-#include "busy.h"
-#include "exception.h"
-#include "instq.h"
-#include "regfile.h"
-#include "rmap.h"
-#include "checkpoint.h"
-
 /*
  * datapath() models a superscalar speculative out-of-order
  * instruction pipeline based on MIPS R10K (as described in
@@ -88,8 +76,8 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  * combinational signals. In this first part, only query methods
  * (corredponding to combination logic) of datapath objects should be
  * invoked.  In the second part, synchronous state changes are
- * committed by either (1) writing to the static variables
- * in datapath() serving as pipeline registers or (2) invoking the
+ * committed by either (1) writing to the member variables
+ * of Datapath serving as pipeline registers or (2) invoking the
  * action methods of objects.
  *
  * Please refer to [Zhao and Hoe, "Using Vivado-HLS for Structural
@@ -100,52 +88,23 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  * Single-step this code in a good debugger to warm up to it.
  */
 
-void datapath(bool I_Reset, // Must be asserted in the first-call to
-			    // datapath
-	      FetchBundle I_2FetchedInsts, // Instructions and
-				           // associated info
-				           // presented for decode
-				           // this cycle
-	      ULONG *O_2Accept, // Number of instructions accepted by
-				// the datapath this cycle
-	      bool *O_6Rewind,  // Requesting a misprediction redirect
-	      bool *O_0Restart, // Requesting a on-exception redirect
-	      ULONG *O_0GotoPC  // Redirect address
-	      ) {
-
-  //
-  // instantiate static datapath objects containing state
-  //
-  static ActiveList activelist;             // in-order buffer for
-					    // inflight instructions
-  static Alu alu[UARCH_EXECUTE_WIDTH];      // this is superscalar!!
-  static Busy busy;                         // busy bit table
-  static Checkpoint checkpoint;             // checkpoint management
-  static Exception exception;               // exception tracking unit
-  static InstQ instq[UARCH_EXECUTE_WIDTH];  // ooo scheduler, aka
-					    // reservation station
-  static RegFile rf;                        // register file, arch+rename
-  static RMapSS rmap;                       // register map table
-
-  //
-  // Instantiate pipeline registers (static variables persistent
-  // across calls to datapath()).  The position of the pipeline
-  // register is indicated by the suffix
-  //
-  static bool handleException_0L0;       // handleException_0 delayed by 1 cycle
-  static ULONG redirectPC_0L0;           // redirect PC for branch or
-					 // exception restart
-  static FetchBundle fetchBndl_2L3;      // fetchBndl_2 delayed by 1 cycle into stage 3 
-  static RMapBundle renamedBndl_2L3;     // renamed operation bundle to dispatch in stage 3
-  static FreeRegBundle freeRegBndl_2L3;  // free reg used by inst to dispatch in stage 3 
-  static ULONG numToDispatch_2L3;        // number of inst to dispatch in stage 3 
-  static bool hasBR_2L3;                 // instBndl in stage 3 has a branch?
-
-  static InstQEntry oprndFetchBndl_4L5[UARCH_EXECUTE_WIDTH];;  // execute bundle in stage 5 (operand)
-
-  static InstQEntry executeBndl_5L6[UARCH_EXECUTE_WIDTH];;  // execute bundle in stage 6 (execute) 
-  static DataValue vs1_5L6[UARCH_EXECUTE_WIDTH]; // vs1 for execute bundle in stage 6 (execute2)
-  static DataValue vs2_5L6[UARCH_EXECUTE_WIDTH]; // vs2 for execute bundle in stage 6 (execute2)
+template<class UArch>
+void Datapath<UArch>::datapath(bool I_Reset, // Must be asserted in the first-call to
+					     // datapath
+			       FetchBundle I_2FetchedInsts, // Instructions and
+							    // associated info
+							    // presented for decode
+							    // this cycle
+			       ULONG *O_2Accept, // Number of instructions accepted by
+						 // the datapath this cycle
+			       bool *O_6Rewind,  // Requesting a misprediction redirect
+			       bool *O_0Restart, // Requesting a on-exception redirect
+			       ULONG *O_0GotoPC, // Redirect address
+			       ULONG *O_0Horizon // Number of following cycles
+						 // that cannot change state
+						 // unless instructions are
+						 // offered
+			       ) {
 
   //
   // output port combinational "next" signal and their default values
@@ -154,6 +113,7 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
   bool OO_6Rewind=false;
   bool OO_0Restart=false;
   ULONG OO_0GotoPC=-1;
+  ULONG OO_0Horizon=0;
 
   if (I_Reset) {
     cout << "DEBUG_VERBOSE=" << DEBUG_VERBOSE << "\n";
@@ -167,9 +127,9 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
     cout << "ARCH_NUM_LOGICAL_REG=" << ARCH_NUM_LOGICAL_REG << "\n";
     cout << "UARCH_ROB_RENAME=" << UARCH_ROB_RENAME << "\n";
     cout << "UARCH_CASCADE_ISSUE4_OPRND5=" << UARCH_CASCADE_ISSUE4_OPRND5 << "\n";
-#if (UARCH_ROB_RENAME)
-    cout << "UARCH_DRIS_CHECKER=" << UARCH_DRIS_CHECKER << "\n";
-#endif
+    if (UARCH_ROB_RENAME) {
+      cout << "UARCH_DRIS_CHECKER=" << UARCH_DRIS_CHECKER << "\n";
+    }
     cout << "UARCH_DECODE_WIDTH=" << UARCH_DECODE_WIDTH << "\n";
     cout << "UARCH_RETIRE_WIDTH=" << UARCH_RETIRE_WIDTH << "\n";
     cout << "UARCH_EXECUTE_WIDTH=" << UARCH_EXECUTE_WIDTH << "\n";
@@ -179,22 +139,7 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
 
     cout << "UARCH_NUM_PHYSICAL_REG=" << UARCH_NUM_PHYSICAL_REG << "\n";
     
-    // reset datapath ojects
-    activelist.rReset();
-    FOR_EXECUTE_WIDTH_i { alu[i].rReset(); }
-    busy.rReset();
-    checkpoint.rReset();
-    exception.rReset();
-    FOR_EXECUTE_WIDTH_i { instq[i].rReset(); }
-    rf.rReset();
-    rmap.rReset();
-
-    // reset pipeline registers
-    handleException_0L0=false;
-    numToDispatch_2L3=0;
-    hasBR_2L3=0;
-    FOR_EXECUTE_WIDTH_i { oprndFetchBndl_4L5[i]=invalidEntryInstQ; }
-    FOR_EXECUTE_WIDTH_i { executeBndl_5L6[i]=invalidEntryInstQ; }
+    rResetState();
   } else { 
     //
     // if not in reset; this is the main body of datapath()
@@ -208,43 +153,42 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
 			       // yet oldest
     bool handleException_0;    // An exception instruction is oldest
 			       // in activelist
-    ULONG redirectPC_0;
-#if (!UARCH_ROB_RENAME)
+    ULONG redirectPC_0=0;
     UnmapBundle unmapBndl_0; // Read back of logged old "rd"
 			     // mappings to walk register rename to
-			     // back to exception point
-    SpeculateMask groundMask_0;   // oldest checkpoint at the moment
-#endif
+			     // back to exception point (R10K only)
+    SpeculateMask groundMask_0;   // oldest checkpoint at the moment (R10K only)
     SpeculateMask dependOnMask_0; // bitmask of dependencies on not
 				  // yet resolved branches
 
     FetchBundle fetchBndl_2;      // upto DECODE_WIDTH no. of instructions provided as input to datapath
+    Cookie cookie_2[UARCH_MAX_DECODE_WIDTH];  // for debug: accepted instructions' magic cookies
     RMapBundle renamedBndl_2;     // upto DECODE_WIDTH no. of renamed instruction objects
     FreeRegBundle freeRegBndl_2;  // upto DECODE_WDITH no. of free registers available for rd remapping
 
     ULONG numToRename_2;          // no. of instruction accepted this cycle
 
-    ULONG instqFree_2[UARCH_EXECUTE_WIDTH];  // no. of free slots in each instruction queue 
+    ULONG instqFree_2[UARCH_MAX_EXECUTE_WIDTH];  // no. of free slots in each instruction queue 
     LONG instqFreeTotal_2=0;                 // total number of slots in instruction queues
     bool hasBR_2;                           // current fetch bundle contains a branch instruction 
-    ULONG newCheckPoint_2;                  // new checkpoint to use by the branch instruction
+    ULONG newCheckPoint_2=0;                // new checkpoint to use by the branch instruction
 
-    bool ts1Busy_3[UARCH_DECODE_WIDTH];     // are rs1 operands of dispatching instructions pending?
-    bool ts2Busy_3[UARCH_DECODE_WIDTH];     // are rs2 operands of dispatching instructions pending?
+    bool ts1Busy_3[UARCH_MAX_DECODE_WIDTH];     // are rs1 operands of dispatching instructions pending?
+    bool ts2Busy_3[UARCH_MAX_DECODE_WIDTH];     // are rs2 operands of dispatching instructions pending?
 
-    InstQEntry issueBndl_4[UARCH_EXECUTE_WIDTH]; // instruction scheduled by instruction queue to issue
+    InstQEntry issueBndl_4[UARCH_MAX_EXECUTE_WIDTH]; // instruction scheduled by instruction queue to issue
 
-    DataValue vs1_5[UARCH_EXECUTE_WIDTH];   // rs1 operand value of executing instruction in stage 5
-    DataValue vs2_5[UARCH_EXECUTE_WIDTH];   // rs2 operand value of executing instructions in stage 5
+    DataValue vs1_5[UARCH_MAX_EXECUTE_WIDTH];   // rs1 operand value of executing instruction in stage 5
+    DataValue vs2_5[UARCH_MAX_EXECUTE_WIDTH];   // rs2 operand value of executing instructions in stage 5
 
-    AluOut aluOut_6[UARCH_EXECUTE_WIDTH];    // result value of executed instructions in stage 6
+    AluOut aluOut_6[UARCH_MAX_EXECUTE_WIDTH];    // result value of executed instructions in stage 6
   
-    bool hasException_6[UARCH_EXECUTE_WIDTH];  // execution resulted in an exception
+    bool hasException_6[UARCH_MAX_EXECUTE_WIDTH];  // execution resulted in an exception
     FOR_EXECUTE_WIDTH_i { hasException_6[i]=false; }
 
-    SpeculateMask exceptionDependOn_6[UARCH_EXECUTE_WIDTH]; // speculation mask of exception instruction
+    SpeculateMask exceptionDependOn_6[UARCH_MAX_EXECUTE_WIDTH]; // speculation mask of exception instruction
 
-    Cookie exceptionCookie_6[UARCH_EXECUTE_WIDTH]; // for debug: exception inst's magic cookie
+    Cookie exceptionCookie_6[UARCH_MAX_EXECUTE_WIDTH]; // for debug: exception inst's magic cookie
 
 
     SpeculateMask rewindMask_6; // indicates which speculative branch
@@ -252,18 +196,19 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
 				// state depending on this
 				// mispredicted branch need to be
 				// flushed out
-    FOR_SPECULATE_DEPTH_i { rewindMask_6.bit[i]=false; }
+    rewindMask_6=ZeroSpeculateMask;
 
     SpeculateMask freeMask_6;  // indicates which speculative branch
 			       // is confirmed; its slot in the branch
 			       // rewind stack is freed and reclaimed
 			       // for use by another speculation level
-    FOR_SPECULATE_DEPTH_i { freeMask_6.bit[i]=false; }
+    freeMask_6=ZeroSpeculateMask;
 
     Cookie branchCookie_6; // for debug: resolving branch's magic cookie   
 
     RetireBundle retireBndl_7;
 
+#if (DEBUG_LEVEL>=DEBUG_SILENT)
     { 
       //
       // for debug: prep debug state at the start of each "cycle"
@@ -277,6 +222,7 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
       rmap.simTick();
       checkpoint.simTick();
     }
+#endif
 
     { 
       //
@@ -292,10 +238,10 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
 	exceptionPending_0=exception.q0Pending();  // any pending exception (possibly speculative)?
 	handleException_0=activelist.q0HandleException(); // pending exception oldest in ROB?
 
-#if (!UARCH_ROB_RENAME)
-	groundMask_0=checkpoint.q0Ground(); // if exception restart, oldest stack to skip to
-	unmapBndl_0=activelist.q0Unmap();   // if exception restart, reg rmaps to undo by playback
-#endif
+	if (!UARCH_ROB_RENAME) {
+	  groundMask_0=checkpoint.q0Ground(); // if exception restart, oldest stack to skip to
+	  unmapBndl_0=activelist.q0Unmap();   // if exception restart, reg rmaps to undo by playback
+	}
 	dependOnMask_0=checkpoint.q0GetMask(); // branch mask of currently unresolved branches
 
 	if (handleException_0) {
@@ -321,6 +267,25 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
 	  // for branch rewind
 	  OO_0GotoPC=redirectPC_0;
 	}
+
+	{
+	  //
+	  // Nothing inflight, nothing in the pipeline registers and no
+	  // exception in progress: this cycle changes no state, and
+	  // neither does any cycle after it until fetch offers an
+	  // instruction
+	  //
+	  bool idle_0=activelist.q0Empty()&&
+	    (!exceptionPending_0)&&(!handleException_0L0)&&
+	    (!maskIsSetSpeculation(dependOnMask_0))&&
+	    (numToDispatch_2L3==0)&&(I_2FetchedInsts.howmany==0);
+
+	  FOR_EXECUTE_WIDTH_i {
+	    idle_0=idle_0&&(!oprndFetchBndl_4L5[i].valid)&&(!executeBndl_5L6[i].valid);
+	  }
+
+	  OO_0Horizon=idle_0?DATAPATH_HORIZON_NEVER:0;
+	}
       } // Stage 0 
 
       { 
@@ -434,12 +399,12 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
 	FOR_EXECUTE_WIDTH_i { issueBndl_4[i]=instq[i].q4Readied(); }
       }
     
-#if (UARCH_CASCADE_ISSUE4_OPRND5)
-      // R10K select instruction for issue and fetch its operands in
-      // same cycle.  In this mode, oprndFetchBndl_4L5 receives
-      // issueBndl_4 combinationally instead of next cycle (stage 5)
-      FOR_EXECUTE_WIDTH_i { oprndFetchBndl_4L5[i]=issueBndl_4[i]; }
-#endif
+      if (UARCH_CASCADE_ISSUE4_OPRND5) {
+	// R10K select instruction for issue and fetch its operands in
+	// same cycle.  In this mode, oprndFetchBndl_4L5 receives
+	// issueBndl_4 combinationally instead of next cycle (stage 5)
+	FOR_EXECUTE_WIDTH_i { oprndFetchBndl_4L5[i]=issueBndl_4[i]; }
+      }
 
       { 
 	//
@@ -465,8 +430,8 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
 	FOR_EXECUTE_WIDTH_i {
 	  aluOut_6[i]=alu[i].q6Execute((executeBndl_5L6[i].valid),  // valid op
 				       executeBndl_5L6[i].op,       // opcode
-				       vs1_5L6[i], vs2_5L6[i],      // operand
-				       executeBndl_5L6[i].cookie);  // debug cookie
+				       vs1_5L6[i], vs2_5L6[i]       // operand
+				       COOKIE_ARG(executeBndl_5L6[i].cookie));  // debug cookie
 	  
 	  if (aluOut_6[i].isBr) {
 	    ASSERT(i==0); // only ALU0 can handle branch
@@ -474,10 +439,10 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
 
 	    if (aluOut_6[i].isMispredict) {
 	      ASSERT(executeBndl_5L6[i].cookie.inst.miss);
-	      rewindMask_6.bit[executeBndl_5L6[i].op.checkpoint]=true;
+	      setSpeculation(&rewindMask_6, executeBndl_5L6[i].op.checkpoint);
 	    } else {
 	      ASSERT(!executeBndl_5L6[i].cookie.inst.miss);
-	      freeMask_6.bit[executeBndl_5L6[i].op.checkpoint]=true;
+	      setSpeculation(&freeMask_6, executeBndl_5L6[i].op.checkpoint);
 	    }
 	  }
 	  
@@ -491,14 +456,13 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
 	  }
 	}
 	
+#if (DEBUG_LEVEL>=DEBUG_SILENT)
 	{ // current datapath assumes at most 1 BR resolution per cycle
-	  ULONG rewindCnt=0, freeCnt=0;
-	  FOR_SPECULATE_DEPTH_i {
-	    rewindCnt+=rewindMask_6.bit[i]?1:0;
-	    freeCnt+=freeMask_6.bit[i]?1:0;
-	  }
+	  ULONG rewindCnt=countSpeculation(rewindMask_6);
+	  ULONG freeCnt=countSpeculation(freeMask_6);
 	  ASSERT((rewindCnt+freeCnt)<=1);
 	}
+#endif
       } // Stage 6 Execute
 
       { 
@@ -507,25 +471,27 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
 	// this cycle (in-order from oldest)
 	//
 	retireBndl_7=activelist.q7toRetire();
-#if (UARCH_ROB_RENAME)
-	// assertions to check consistency
-	FOR_RETIRE_WIDTH_i {
-	  RenameTag td=retireBndl_7.td[i];
-	  DataValue val=rf.q5Read(tagToPRegIdx(td));
-	  Cookie cookie=retireBndl_7.cookie[i];
-	  retireBndl_7.val[i]=val;
-	  if (i<retireBndl_7.howmany) {
-	    ASSERT(tagEqual(td,cookie.op.td));
-	    if (!tagEqual(td,ZeroRegTag)) {
-	      ASSERT(retireBndl_7.val[i]==cookie.vd);
-	    } else {
-	      ASSERT(retireBndl_7.val[i]==0);
+	if (UARCH_ROB_RENAME) {
+	  // assertions to check consistency
+	  FOR_RETIRE_WIDTH_i {
+	    RenameTag td=retireBndl_7.td[i];
+	    DataValue val=rf.q5Read(tagToPRegIdx(td));
+	    retireBndl_7.val[i]=val;
+#if (DEBUG_LEVEL>=DEBUG_SILENT)
+	    Cookie cookie=retireBndl_7.cookie[i];
+	    if (i<retireBndl_7.howmany) {
+	      ASSERT(tagEqual(td,cookie.op.td));
+	      if (!tagEqual(td,ZeroRegTag)) {
+		ASSERT(retireBndl_7.val[i]==cookie.vd);
+	      } else {
+		ASSERT(retireBndl_7.val[i]==0);
+	      }
 	    }
+#endif
 	  }
+	} else {
+	  // Not much happens at R10K retirement 
 	}
-#else
-	// Not much happens at R10K retirement 
-#endif
       }
     } // End of Tick
 
@@ -535,12 +501,12 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
     RMapBundle renamedBndl_3_;  
     renamedBndl_3_=renamedBndl_2L3;
 
-    InstQEntry oprndFetchBndl_5_[UARCH_EXECUTE_WIDTH]; 
-#if (!UARCH_CASCADE_ISSUE4_OPRND5)
-    FOR_EXECUTE_WIDTH_i { oprndFetchBndl_5_[i]=oprndFetchBndl_4L5[i]; }
-#endif
+    InstQEntry oprndFetchBndl_5_[UARCH_MAX_EXECUTE_WIDTH]; 
+    if (!UARCH_CASCADE_ISSUE4_OPRND5) {
+      FOR_EXECUTE_WIDTH_i { oprndFetchBndl_5_[i]=oprndFetchBndl_4L5[i]; }
+    }
 
-    InstQEntry executeBndl_6_[UARCH_EXECUTE_WIDTH];
+    InstQEntry executeBndl_6_[UARCH_MAX_EXECUTE_WIDTH];
     FOR_EXECUTE_WIDTH_i { executeBndl_6_[i]=executeBndl_5L6[i]; }
     
     { 
@@ -590,44 +556,44 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
 	}
       }
 
-#if (UARCH_ROB_RENAME)
-      for(ULONG i=0; i<retireBndl_7.howmany; i++) {
-	RenameTag td=retireBndl_7.td[i];
-	RenameTag ltag={.mapped=false, .idx=retireBndl_7.rd[i]};
-
-	// On retirement, results of retiring instructions are copied
-	// from ROB to RF.  Need to forward to inflight instructions
-	// holding old renames (in 3 stages).  We could be clever and
-	// avoid this by comparing the rename tags to the current
-	// oldest slot in ROB to realize if a rename has expired.
-	if (!tagEqual(td, ZeroRegTag)) {
-	  FOR_DECODE_WIDTH_j {
-	    if (tagEqual(td,renamedBndl_2.op[j].ts1)) {
-	      renamedBndl_2.op[j].ts1=ltag;
-	    }
-	    if (tagEqual(td,renamedBndl_2.op[j].ts2)) {
-	      renamedBndl_2.op[j].ts2=ltag;
-	    }
-	  }
-	  FOR_DECODE_WIDTH_j {
-	    if (tagEqual(td,renamedBndl_2L3.op[j].ts1)) {
-	      renamedBndl_3_.op[j].ts1=ltag;
-	    }
-	    if (tagEqual(td,renamedBndl_2L3.op[j].ts2)) {
-	      renamedBndl_3_.op[j].ts2=ltag;
+      if (UARCH_ROB_RENAME) {
+	for(ULONG i=0; i<retireBndl_7.howmany; i++) {
+	  RenameTag td=retireBndl_7.td[i];
+	  RenameTag ltag={.mapped=false, .idx=retireBndl_7.rd[i]};
+
+	  // On retirement, results of retiring instructions are copied
+	  // from ROB to RF.  Need to forward to inflight instructions
+	  // holding old renames (in 3 stages).  We could be clever and
+	  // avoid this by comparing the rename tags to the current
+	  // oldest slot in ROB to realize if a rename has expired.
+	  if (!tagEqual(td, ZeroRegTag)) {
+	    FOR_DECODE_WIDTH_j {
+	      if (tagEqual(td,renamedBndl_2.op[j].ts1)) {
+		renamedBndl_2.op[j].ts1=ltag;
+	      }
+	      if (tagEqual(td,renamedBndl_2.op[j].ts2)) {
+		renamedBndl_2.op[j].ts2=ltag;
+	      }
 	    }
-	  }
-	  FOR_EXECUTE_WIDTH_j {
-	    if (tagEqual(td,issueBndl_4[j].op.ts1)) {
-	      issueBndl_4[j].op.ts1=ltag;
+	    FOR_DECODE_WIDTH_j {
+	      if (tagEqual(td,renamedBndl_2L3.op[j].ts1)) {
+		renamedBndl_3_.op[j].ts1=ltag;
+	      }
+	      if (tagEqual(td,renamedBndl_2L3.op[j].ts2)) {
+		renamedBndl_3_.op[j].ts2=ltag;
+	      }
 	    }
-	    if (tagEqual(td,issueBndl_4[j].op.ts2)) {
-	      issueBndl_4[j].op.ts2=ltag;
+	    FOR_EXECUTE_WIDTH_j {
+	      if (tagEqual(td,issueBndl_4[j].op.ts1)) {
+		issueBndl_4[j].op.ts1=ltag;
+	      }
+	      if (tagEqual(td,issueBndl_4[j].op.ts2)) {
+		issueBndl_4[j].op.ts2=ltag;
+	      }
 	    }
 	  }
 	}
       }
-#endif
       
       //
       // When branch resolves, whether confirm or rewind, a
@@ -639,7 +605,7 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
 	  if (hasException_6[i]) {
 	    if (dependOnSpeculation(exceptionDependOn_6[i], freeMask_6)) {
 	      // forward BR confirmation
-	      exceptionDependOn_6[i].bit[whichSpeculation(freeMask_6)]=false;
+	      clearSpeculation(&exceptionDependOn_6[i], freeMask_6);
 	    }
 	    if (dependOnSpeculation(exceptionDependOn_6[i], rewindMask_6)) {
 	      // cancelled by BR mispredict
@@ -657,31 +623,31 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
 	    issueBndl_4[i].valid=false;
 	  }
 	  if (dependOnSpeculation(issueBndl_4[i].op.dependOn, freeMask_6)) {
-	    issueBndl_4[i].op.dependOn.bit[whichSpeculation(freeMask_6)]=false;
+	    clearSpeculation(&issueBndl_4[i].op.dependOn, freeMask_6);
 	  }
 
-#if (!UARCH_CASCADE_ISSUE4_OPRND5)
-	  if (dependOnSpeculation(oprndFetchBndl_4L5[i].op.dependOn, rewindMask_6)) {
-	    prettyPrint(OkSTAGE, oprndFetchBndl_4L5[i].op, oprndFetchBndl_4L5[i].cookie);
-	    oprndFetchBndl_5_[i].valid=false;
-	  }
-	  if (dependOnSpeculation(oprndFetchBndl_4L5[i].op.dependOn, freeMask_6)) {
-	    oprndFetchBndl_5_[i].op.dependOn.bit[whichSpeculation(freeMask_6)]=false;
+	  if (!UARCH_CASCADE_ISSUE4_OPRND5) {
+	    if (dependOnSpeculation(oprndFetchBndl_4L5[i].op.dependOn, rewindMask_6)) {
+	      prettyPrint(OkSTAGE, oprndFetchBndl_4L5[i].op, oprndFetchBndl_4L5[i].cookie);
+	      oprndFetchBndl_5_[i].valid=false;
+	    }
+	    if (dependOnSpeculation(oprndFetchBndl_4L5[i].op.dependOn, freeMask_6)) {
+	      clearSpeculation(&oprndFetchBndl_5_[i].op.dependOn, freeMask_6);
+	    }
+	  } else {
+	    // if stage 4 and 5 are collapsed, issueBndl and oprndFetchBndl are the same
+	    FOR_EXECUTE_WIDTH_i { oprndFetchBndl_5_[i]=issueBndl_4[i]; }
 	  }
-#else
-	  // if stage 4 and 5 are collapsed, issueBndl and oprndFetchBndl are the same
-	  FOR_EXECUTE_WIDTH_i { oprndFetchBndl_5_[i]=issueBndl_4[i]; }
-#endif
 	}
 
 	FOR_DECODE_WIDTH_i {
 	  if (dependOnSpeculation(renamedBndl_2.op[i].dependOn, freeMask_6)) {
-	    renamedBndl_2.op[i].dependOn.bit[whichSpeculation(freeMask_6)]=false;
+	    clearSpeculation(&renamedBndl_2.op[i].dependOn, freeMask_6);
 	  }
 	}
 	FOR_DECODE_WIDTH_i {
 	  if (dependOnSpeculation(renamedBndl_2L3.op[i].dependOn, freeMask_6)) {
-	    renamedBndl_3_.op[i].dependOn.bit[whichSpeculation(freeMask_6)]=false;
+	    clearSpeculation(&renamedBndl_3_.op[i].dependOn, freeMask_6);
 	  }
 	}
       }
@@ -708,40 +674,42 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
 	  //
 	  activelist.a7Retire(retireBndl_7); // retire oldest completed, non-exception instructions
 
-#if (UARCH_ROB_RENAME)
-	  ASSERT(retireBndl_7.howmany<=UARCH_RETIRE_WIDTH);
-	  for(ULONG i=0; i<retireBndl_7.howmany; i++) {
-	    LogicalRegName rd=retireBndl_7.rd[i];
-	    RenameTag td=retireBndl_7.td[i];
-	    DataValue val=retireBndl_7.val[i];
-
-	    ASSERT(rd==retireBndl_7.cookie[i].inst.rd);
-	    ASSERT(tagEqual(td,retireBndl_7.cookie[i].op.td));
-	    if (rd!=0) {
-	      ASSERT(val==retireBndl_7.cookie[i].vd);
-	    }
+	  if (UARCH_ROB_RENAME) {
+	    ASSERT(retireBndl_7.howmany<=UARCH_RETIRE_WIDTH);
+	    for(ULONG i=0; i<retireBndl_7.howmany; i++) {
+	      LogicalRegName rd=retireBndl_7.rd[i];
+	      RenameTag td=retireBndl_7.td[i];
+	      DataValue val=retireBndl_7.val[i];
+
+	      ASSERT(rd==retireBndl_7.cookie[i].inst.rd);
+	      ASSERT(tagEqual(td,retireBndl_7.cookie[i].op.td));
+	      if (rd!=0) {
+		ASSERT(val==retireBndl_7.cookie[i].vd);
+	      }
 
-	    // if ROB rename, write retiring instruction's result to
-	    // the in-order-commit register file
-	    rf.a6Write((PhysicalRegIdx)rd, val);
+	      // if ROB rename, write retiring instruction's result to
+	      // the in-order-commit register file
+	      rf.a6Write((PhysicalRegIdx)rd, val);
 
-	    // unmap tag from map table if the latest
-	    rmap.a7Unmap(rd, td);
+	      // unmap tag from map table if the latest
+	      rmap.a7Unmap(rd, td);
 
-	    {
-	      // unmap tag from operands of instructions in the instqs
-	      RenameTag temp={.mapped=false, .idx=rd};
-	      FOR_EXECUTE_WIDTH_j {
-		instq[j].a7retireTag(td, temp, retireBndl_7.cookie[i]);
+	      {
+		// unmap tag from operands of instructions in the instqs
+		RenameTag temp={.mapped=false, .idx=rd};
+		FOR_EXECUTE_WIDTH_j {
+		  instq[j].a7retireTag(td, temp COOKIE_ARG(retireBndl_7.cookie[i]));
+		}
 	      }
 	    }
 	  }
-#endif
 	} // stage 7 Retire
 	
 	{ // Stage 6 Execute
+#if (DEBUG_LEVEL>=DEBUG_SILENT)
 	  bool rewindedDEBUG=false;
 	  bool clearedDEBUG=false;
+#endif
 	  
 	  FOR_EXECUTE_WIDTH_i {
 	    if (executeBndl_6_[i].valid) {
@@ -776,22 +744,24 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
 		ASSERT(executeBndl_6_[i].cookie.inst.miss);
 		ASSERT(!rewindedDEBUG);
 		ASSERT(maskIsSetOnceSpeculation(rewindMask_6));
+#if (DEBUG_LEVEL>=DEBUG_SILENT)
 		rewindedDEBUG=true;
+#endif
 		
 		// rewind to checkpointed state
-#if (UARCH_ROB_RENAME)
-		activelist.a6Rewind(executeBndl_6_[i].atag);
-#else
-		activelist.a6Rewind(executeBndl_6_[i].op.checkpoint);
-#endif
+		if (UARCH_ROB_RENAME) {
+		  activelist.a6Rewind(executeBndl_6_[i].atag);
+		} else {
+		  activelist.a6Rewind(executeBndl_6_[i].op.checkpoint);
+		}
 		rmap.a6Rewind(executeBndl_6_[i].op.checkpoint);
 		
 		FOR_EXECUTE_WIDTH_j {
 		  // squash inflight wrongpath instructions, if any
-		  instq[j].a6Squash(rewindMask_6, branchCookie_6);
+		  instq[j].a6Squash(rewindMask_6 COOKIE_ARG(branchCookie_6));
 		}
 		// cancel on-wrongpath pending exceptions, if any
-		exception.a6Cancel(rewindMask_6, branchCookie_6);
+		exception.a6Cancel(rewindMask_6 COOKIE_ARG(branchCookie_6));
 		
 		// rewind branch stack
 		checkpoint.a6Rewind(rewindMask_6);
@@ -805,14 +775,16 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
 		ASSERT(!executeBndl_6_[i].cookie.inst.miss);
 		ASSERT(!clearedDEBUG);
 		ASSERT(maskIsSetOnceSpeculation(freeMask_6));
+#if (DEBUG_LEVEL>=DEBUG_SILENT)
 		clearedDEBUG=true;
+#endif
 		
 		// clear depend-on bits of flight-masks so the
 		// corresponding branch stack slot can be reused
 		FOR_EXECUTE_WIDTH_j { 
-		  instq[j].a6ClearMask(freeMask_6, branchCookie_6); 
+		  instq[j].a6ClearMask(freeMask_6 COOKIE_ARG(branchCookie_6)); 
 		}
-		exception.a6ClearMask(freeMask_6, branchCookie_6);
+		exception.a6ClearMask(freeMask_6 COOKIE_ARG(branchCookie_6));
 		
 		// notice activelist and rmap do not need to be cleared
 		// since they do not track speculation
@@ -821,6 +793,7 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
 		
 		// free up this branch stack slot for reuse 
 		checkpoint.a6Free(freeMask_6);
+		rmap.a6Free(whichSpeculation(freeMask_6));
 	      }
 	    }
 	  }
@@ -832,7 +805,7 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
 	      // the dominate relationship to keep the "less
 	      // speculative" one. raising an exception stops fetching
 	      // immediately to stop growing the state to be undone.
-	      exception.a6Raise(exceptionDependOn_6[i], exceptionCookie_6[i]);
+	      exception.a6Raise(exceptionDependOn_6[i] COOKIE_ARG(exceptionCookie_6[i]));
 	    }
 	  }
 	  
@@ -857,14 +830,14 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
 	  if (issueBndl_4[i].valid) {
 	    // issue scheduled instructions
 	    instq[i].a4Issue(issueBndl_4[i].slotIdx);
-#if (UARCH_DRIS_CHECKER)
-	    // double check issue against centralized DRIS bookkeeping
-	    activelist.d4CheckIssue(issueBndl_4[i]);
-#endif
+	    if (UARCH_DRIS_CHECKER) {
+	      // double check issue against centralized DRIS bookkeeping
+	      activelist.d4CheckIssue(issueBndl_4[i]);
+	    }
 	    FOR_EXECUTE_WIDTH_j {
 	      // release instq instructions dependent on this
 	      // instruction for scheduling starting next cycle
-	      instq[j].a4Release(issueBndl_4[i].op.td, issueBndl_4[i].cookie );
+	      instq[j].a4Release(issueBndl_4[i].op.td COOKIE_ARG(issueBndl_4[i].cookie));
 	    }
 	    // clear busy table; inflight insts updated by forwarding above
 	    busy.a4ClearBusy(tagToPRegIdx(issueBndl_4[i].op.td));
@@ -884,7 +857,7 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
 	    // if rewinding (1-cycle), none of this happened.  Need to
 	    // keep going on an exception though; until it is the
 	    // oldest, it may be speculative.
-	    ULONG inserted[UARCH_EXECUTE_WIDTH];
+	    ULONG inserted[UARCH_MAX_EXECUTE_WIDTH];
 	    
 	    FOR_EXECUTE_WIDTH_i { inserted[i]=0; }
 	    
@@ -893,7 +866,7 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
 	      // we are counting down, so if there is a BR (it must be
 	      // the last of the bundle and there can only be one in a
 	      // bundle), it is going into ALU0 without further fuss.
-	      prettyPrint(DSTAGE, renamedBndl_3_.op[i], fetchBndl_2L3.cookie[i]);
+	      prettyPrint(DSTAGE, renamedBndl_3_.op[i], cookie_2L3[i]);
 	      
 	      {
 		ULONG loopcnt=0;
@@ -923,8 +896,8 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
 		// dispatching into instruction queue
 		Operation op=renamedBndl_3_.op[i];
 		instq[j].a3Insert(freeRegBndl_2L3.atag[i], op, 
-				  ts1Busy_3[i], ts2Busy_3[i], 
-				  fetchBndl_2L3.cookie[i]);
+				  ts1Busy_3[i], ts2Busy_3[i]
+				  COOKIE_ARG(cookie_2L3[i]));
 	      }
 	      inserted[j]++;
 	      j+=1;
@@ -940,21 +913,17 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
 	    OO_2Accept=numToRename_2;
 	    
 #if (DEBUG_LEVEL>=DEBUG_SILENT)
-	    FOR_DECODE_WIDTH_i {
-	      // okay to overrun numToRename_2; don't care for rest
-	      fetchBndl_2.cookie[i].op=renamedBndl_2.op[i];
+	    for(ULONG i=0; i<numToRename_2; i++) {
+	      cookie_2[i]=fetchBndl_2.cookie[i];
+	      cookie_2[i].op=renamedBndl_2.op[i];
 	    }      
 #endif
 
 	    // entire new instructions into activelist
 	    activelist.a2Accept(numToRename_2, fetchBndl_2.inst, fetchBndl_2.pcLike,
-#if (!UARCH_ROB_RENAME)
-				renamedBndl_2.tdOld, 
-#endif
-#if (UARCH_DRIS_CHECKER)
-				renamedBndl_2,
-#endif
-				fetchBndl_2.cookie);
+				renamedBndl_2.tdOld, // R10K only
+				renamedBndl_2        // UARCH_DRIS_CHECKER only
+				COOKIE_ARG(cookie_2));
 	    
 	    // set new rename mappings
 	    rmap.a2SetMapSS(numToRename_2, fetchBndl_2.inst, freeRegBndl_2.free);
@@ -972,14 +941,38 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
 	      ASSERT(fetchBndl_2.inst[numToRename_2-1].opcode==BEQ);
 
 	      checkpoint.a2New(newCheckPoint_2);
-#if (!UARCH_ROB_RENAME)
-	      activelist.a2CheckPoint(newCheckPoint_2);
-#endif
+	      if (!UARCH_ROB_RENAME) {
+		activelist.a2CheckPoint(newCheckPoint_2);
+	      }
 	      rmap.a2CheckPoint(newCheckPoint_2);
 	    }
 	  }
 	} // Stage 2 Map
       } // stage 7 down to 2
+
+      { 
+	//
+	// for statistics: charge a decode stall to the first resource
+	// that held numToRename_2 below what fetch offered
+	//
+	ULONG offered=MIN(fetchBndl_2.howmany, UARCH_DECODE_WIDTH);
+
+	if (offered) {
+	  if (exceptionPending_0||handleException_0L0) {
+	    mStats.stallException++;
+	  } else if (maskIsSetSpeculation(rewindMask_6)) {
+	    // counted as a rewind
+	  } else if (numToRename_2<offered) {
+	    if (freeRegBndl_2.howmany<offered) {
+	      mStats.stallActiveList++;
+	    } else if ((ULONG)instqFreeTotal_2<offered) {
+	      mStats.stallInstQ++;
+	    } else {
+	      mStats.stallBranch++;
+	    }
+	  }
+	}
+      }
       
       { // Stage 0
 	if (handleException_0) {
@@ -989,26 +982,26 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
 
 	  FOR_EXECUTE_WIDTH_i { instq[i].rReset(); alu[i].rReset(); }
 
-#if (UARCH_ROB_RENAME)
-	  activelist.rReset();
-	  rmap.rReset();
-	  busy.rReset();
-	  checkpoint.rReset();
-#else
-	  if (maskIsSetSpeculation(dependOnMask_0)) {
-	    // first recover off the oldest entry on rewind stack if
-	    // one is available
-	    ASSERT(maskIsSetOnceSpeculation(groundMask_0));
-	    checkpoint.a6Rewind(groundMask_0);
-	    rmap.a6Rewind(whichSpeculation(groundMask_0));
-	    activelist.a6Rewind(whichSpeculation(groundMask_0));
+	  if (UARCH_ROB_RENAME) {
+	    activelist.rReset();
+	    rmap.rReset();
+	    busy.rReset();
+	    checkpoint.rReset();
 	  } else {
-	    // then walk back the mappings sequentially
-	    ASSERT(unmapBndl_0.howmany!=0);
-	    rmap.a0UnmapSS(unmapBndl_0.howmany, unmapBndl_0.rd, unmapBndl_0.tdOld);
-	    activelist.a0Unmap(unmapBndl_0.howmany);  // walk back the activelist youngest first
+	    if (maskIsSetSpeculation(dependOnMask_0)) {
+	      // first recover off the oldest entry on rewind stack if
+	      // one is available
+	      ASSERT(maskIsSetOnceSpeculation(groundMask_0));
+	      checkpoint.a6Rewind(groundMask_0);
+	      rmap.a6Rewind(whichSpeculation(groundMask_0));
+	      activelist.a6Rewind(whichSpeculation(groundMask_0));
+	    } else {
+	      // then walk back the mappings sequentially
+	      ASSERT(unmapBndl_0.howmany!=0);
+	      rmap.a0UnmapSS(unmapBndl_0.howmany, unmapBndl_0.rd, unmapBndl_0.tdOld);
+	      activelist.a0Unmap(unmapBndl_0.howmany);  // walk back the activelist youngest first
+	    }
 	  }
-#endif
 	}
 
 	if (handleException_0L0&&(!handleException_0)) {
@@ -1019,14 +1012,14 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
 
 	  FOR_EXECUTE_WIDTH_i { instq[i].rReset(); alu[i].rReset(); }
 
-#if (UARCH_ROB_RENAME)
-	  activelist.rReset();
-	  rmap.rReset();
-	  busy.rReset();
-	  checkpoint.rReset();
-#else
-	  // checkpoint.a0Continue();
-#endif
+	  if (UARCH_ROB_RENAME) {
+	    activelist.rReset();
+	    rmap.rReset();
+	    busy.rReset();
+	    checkpoint.rReset();
+	  } else {
+	    // checkpoint.a0Continue();
+	  }
 	}
       } // Stage 0
 
@@ -1041,16 +1034,16 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
 	    executeBndl_5L6[i]=oprndFetchBndl_5_[i];
 	  }
 	  
-#if (UARCH_CASCADE_ISSUE4_OPRND5)
-	  // the register for oprndFetchBndl_4L5[i] doesn't exist if
-	  // issue and oprand stage are cascaded combinationally.
-#else
-	  if (handleException_0L0 || handleException_0) {
-	    oprndFetchBndl_4L5[i].valid=false;
+	  if (UARCH_CASCADE_ISSUE4_OPRND5) {
+	    // the register for oprndFetchBndl_4L5[i] doesn't exist if
+	    // issue and oprand stage are cascaded combinationally.
 	  } else {
-	    oprndFetchBndl_4L5[i]=issueBndl_4[i];
+	    if (handleException_0L0 || handleException_0) {
+	      oprndFetchBndl_4L5[i].valid=false;
+	    } else {
+	      oprndFetchBndl_4L5[i]=issueBndl_4[i];
+	    }
 	  }
-#endif
           vs1_5L6[i]=vs1_5[i];
           vs2_5L6[i]=vs2_5[i];
         }
@@ -1058,13 +1051,14 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
 	if (!(exceptionPending_0||maskIsSetSpeculation(rewindMask_6))) {
 	  numToDispatch_2L3=numToRename_2;
 	  freeRegBndl_2L3=freeRegBndl_2;
-	  fetchBndl_2L3=fetchBndl_2;
+	  for(ULONG i=0; i<numToRename_2; i++) {
+	    cookie_2L3[i]=cookie_2[i];
+	  }
 	  renamedBndl_2L3=renamedBndl_2;
 	  hasBR_2L3=hasBR_2;
 	} else {
 	  numToDispatch_2L3=0;
 	  freeRegBndl_2L3.howmany=0;
-	  fetchBndl_2L3.howmany=0;
 	  renamedBndl_2L3.howmany=0;
 	  hasBR_2L3=false;
 	}
@@ -1080,7 +1074,83 @@ void datapath(bool I_Reset, // Must be asserted in the first-call to
   *O_6Rewind=OO_6Rewind;
   *O_0Restart=OO_0Restart;
   *O_0GotoPC=OO_0GotoPC;
+  *O_0Horizon=OO_0Horizon;
+}
+
+template<class UArch>
+void Datapath<UArch>::rResetState() {
+  // reset datapath ojects
+  activelist.rReset();
+  FOR_EXECUTE_WIDTH_i { alu[i].rReset(); }
+  busy.rReset();
+  checkpoint.rReset();
+  exception.rReset();
+  FOR_EXECUTE_WIDTH_i { instq[i].rReset(); }
+  rf.rReset();
+  rmap.rReset();
+
+  // reset pipeline registers
+  handleException_0L0=false;
+  numToDispatch_2L3=0;
+  hasBR_2L3=0;
+  FOR_EXECUTE_WIDTH_i { oprndFetchBndl_4L5[i]=invalidEntryInstQ; }
+  FOR_EXECUTE_WIDTH_i { executeBndl_5L6[i]=invalidEntryInstQ; }
+}
+
+template<class UArch>
+void Datapath<UArch>::rSeed(const DataValue archRF[ARCH_NUM_LOGICAL_REG]) {
+  // a reset RMap maps each logical register to the physical register
+  // of the same index and Busy has nothing pending, which is how the
+  // seeded values are found
+  rResetState();
+  rf.rSeed(archRF);
 }
 
+template<class UArch>
+void Datapath<UArch>::rSnapshot(Snapshot *snap) {
+  // datapath objects
+  activelist.rSnapshot(snap);
+  busy.rSnapshot(snap);
+  checkpoint.rSnapshot(snap);
+  exception.rSnapshot(snap);
+  FOR_EXECUTE_WIDTH_i { instq[i].rSnapshot(snap); }
+  rf.rSnapshot(snap);
+  rmap.rSnapshot(snap);
+
+  // pipeline registers
+  SNAP(snap, handleException_0L0);
+  SNAP(snap, redirectPC_0L0);
+  SNAP(snap, cookie_2L3);
+  SNAP(snap, renamedBndl_2L3);
+  SNAP(snap, freeRegBndl_2L3);
+  SNAP(snap, numToDispatch_2L3);
+  SNAP(snap, hasBR_2L3);
+  SNAP(snap, oprndFetchBndl_4L5);
+  SNAP(snap, executeBndl_5L6);
+  SNAP(snap, vs1_5L6);
+  SNAP(snap, vs2_5L6);
+}
 
+////////////////////////////////////////////////////////
+//
+// Constructors
+//
+////////////////////////////////////////////////////////
+template<class UArch>
+Datapath<UArch>::Datapath(const SimConfig *config) : 
+  Core(config),
+  instq(new InstQ<UArch>[UARCH_EXECUTE_WIDTH]),
+  // pipeline registers power up cleared
+  handleException_0L0(false), redirectPC_0L0(0), 
+  cookie_2L3(), renamedBndl_2L3(), freeRegBndl_2L3(), 
+  numToDispatch_2L3(0), hasBR_2L3(false),
+  oprndFetchBndl_4L5(), executeBndl_5L6(), vs1_5L6(), vs2_5L6() {
+}
+
+template<class UArch>
+Datapath<UArch>::~Datapath() {
+  delete[] instq;
+}
 
+#define INSTANTIATE_DATAPATH(U) template class Datapath<U>;
+UARCH_FOR_EACH(INSTANTIATE_DATAPATH)
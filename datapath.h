@@ -26,9 +26,23 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "sim.h"
 #include "arch.h"
 #include "uarch.h"
+#include "config.h"
 
+#include "core.h"
 #include "fetch.h"
 
+//
+// Datapath Objects
+//
+#include "activelist.h"
+#include "alu.h"
+#include "busy.h"
+#include "exception.h"
+#include "instq.h"
+#include "regfile.h"
+#include "rmap.h"
+#include "checkpoint.h"
+
 /*
  * One invocation of datapath() corresponds to 1 cycle of the
  * out-of-order core. I_ arguments correspond to input ports.  O_
@@ -36,7 +50,7 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  * final combinational values when datapath() returns.  O_ arguements
  * are assigned to and never read from inside the function.  
  *
- * Static variables and objects inside datapth() represent synchronous
+ * Member objects and variables of Datapath represent synchronous
  * states that are carried from invocation to invocation (i.e.,
  * cycle-to-cycle).  They are only modified at the end of the function.
  *
@@ -46,16 +60,68 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  * RTL model is compatible with Xilinx Vivado HLS synthesis.
  */
 
-void datapath(bool I_Reset, // Must be asserted in the first-call to
-			    // datapath
-	      FetchBundle I_2FetchedInsts, // Instructions and associated
-				       // info presented for decode
-				       // this cycle
-	      ULONG *O_2Accept, // Number of instructions accepted by
-				// the datapath this cycle
-	      bool *O_6Rewind,  // Requesting a misprediction redirect
-	      bool *O_0Restart, // Requesting a on-exception redirect
-	      ULONG *O_0GotoPC  // Redirect address
-	      ); 
+template<class UArch>
+class Datapath : public Core {
+ public:
+  // Constructor
+  Datapath(const SimConfig *config);
+  ~Datapath();
+
+ protected:
+  void datapath(bool I_Reset, // Must be asserted in the first-call to
+			      // datapath
+		FetchBundle I_2FetchedInsts, // Instructions and associated
+					     // info presented for decode
+					     // this cycle
+		ULONG *O_2Accept, // Number of instructions accepted by
+				  // the datapath this cycle
+		bool *O_6Rewind,  // Requesting a misprediction redirect
+		bool *O_0Restart, // Requesting a on-exception redirect
+		ULONG *O_0GotoPC, // Redirect address
+		ULONG *O_0Horizon // Number of following cycles that
+				  // cannot change state unless
+				  // instructions are offered
+		); 
+
+  void rSeed(const DataValue archRF[ARCH_NUM_LOGICAL_REG]);
+  void rSnapshot(Snapshot *snap);
+
+ private:
+  //
+  // datapath objects containing state
+  //
+  ActiveList<UArch> activelist;      // in-order buffer for
+				     // inflight instructions
+  Alu alu[UARCH_MAX_EXECUTE_WIDTH];  // this is superscalar!!
+  Busy busy;                         // busy bit table
+  Checkpoint<UArch> checkpoint;      // checkpoint management
+  Exception exception;               // exception tracking unit
+  InstQ<UArch> *instq;               // ooo scheduler, aka
+				     // reservation station;
+				     // UARCH_EXECUTE_WIDTH of them
+  RegFile rf;                        // register file, arch+rename
+  RMapSS<UArch> rmap;                // register map table
+
+  //
+  // pipeline registers.  The position of the pipeline register is
+  // indicated by the suffix
+  //
+  bool handleException_0L0;       // handleException_0 delayed by 1 cycle
+  ULONG redirectPC_0L0;           // redirect PC for branch or
+				  // exception restart
+  Cookie cookie_2L3[UARCH_MAX_DECODE_WIDTH];  // cookie_2 delayed by 1 cycle into stage 3 
+  RMapBundle renamedBndl_2L3;     // renamed operation bundle to dispatch in stage 3
+  FreeRegBundle freeRegBndl_2L3;  // free reg used by inst to dispatch in stage 3 
+  ULONG numToDispatch_2L3;        // number of inst to dispatch in stage 3 
+  bool hasBR_2L3;                 // instBndl in stage 3 has a branch?
+
+  InstQEntry oprndFetchBndl_4L5[UARCH_MAX_EXECUTE_WIDTH];  // execute bundle in stage 5 (operand)
+
+  InstQEntry executeBndl_5L6[UARCH_MAX_EXECUTE_WIDTH];  // execute bundle in stage 6 (execute) 
+  DataValue vs1_5L6[UARCH_MAX_EXECUTE_WIDTH]; // vs1 for execute bundle in stage 6 (execute2)
+  DataValue vs2_5L6[UARCH_MAX_EXECUTE_WIDTH]; // vs2 for execute bundle in stage 6 (execute2)
+
+  void rResetState();  // all of the above
+};
 
 #endif
@@ -0,0 +1,111 @@
+#define DECODE_CPP
+#define MAIN_CPP  // this is a main program; instantiate tables in arch.h
+/*********************************************************************
+Copyright 2019 James C. Hoe
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+
+#include <cstring>
+#include <cstdio>
+
+#include "sim.h"
+#include "arch.h"
+
+#include "eventlog.h"
+
+/*
+ * ooo-decode prints a pipeline event log (see eventlog.h) as the
+ * text the logged run would have printed.
+ *
+ *    ooo-decode [FILE]
+ *
+ * FILE is "-" or absent for stdin.
+ */
+
+static void usage(const char *prog) {
+  cerr << "usage: " << prog << " [event-log]\n";
+}
+
+int main(int argc, char *argv[]) {
+  const char *filename=(argc>1)?argv[1]:"-";
+  FILE *file;
+  EventLogHeader header;
+  EventRecord *buffer;
+  ULONG bytes;
+
+  if ((argc>2)||((argc>1)&&((!strcmp(argv[1], "-h"))||(!strcmp(argv[1], "--help"))))) {
+    usage(argv[0]);
+    return (argc>2)?1:0;
+  }
+
+  file=strcmp(filename, "-")?fopen(filename, "rb"):stdin;
+  if (!file) {
+    cerr << "decode: " << filename << ": cannot open\n";
+    return 1;
+  }
+  if ((fread(&header, sizeof(header), 1, file)!=1)||
+      memcmp(header.magic, EVENTLOG_MAGIC, sizeof(header.magic))||
+      (header.version!=EVENTLOG_VERSION)||
+      (header.recordBytes!=sizeof(EventRecord))) {
+    cerr << "decode: " << filename << ": not an event log of this version\n";
+    return 1;
+  }
+
+  buffer=new EventRecord[EVENTLOG_READ_RECORDS];
+  // by bytes, so that a partial record at the end shows; fread()
+  // comes up short only there
+  while((bytes=fread(buffer, 1, EVENTLOG_READ_RECORDS*sizeof(EventRecord), file))>0) {
+    ULONG n=bytes/sizeof(EventRecord);
+
+    for(ULONG i=0; i<n; i++) {
+      const EventRecord *rec=&buffer[i];
+
+      const char *stage=eventString(eventStage, rec->stage);
+      const char *prefix=eventString(eventPrefix, rec->prefix);
+      const char *suffix=eventString(eventSuffix, rec->suffix);
+
+      if ((rec->kind==EVENT_TEXT)&&(rec->length<=EVENTLOG_TEXT_BYTES)) {
+	cout.write(rec->u.text, rec->length);
+      } else if ((rec->kind==EVENT_PIPE)&&stage&&prefix&&suffix&&
+		 (rec->u.pipe.opcode<DONTCARE)) {
+	eventRender(cout, rec, stage, prefix, suffix);
+      } else {
+	cerr << "decode: " << filename << ": corrupt record\n";
+	return 1;
+      }
+    }
+    if (bytes%sizeof(EventRecord)) {
+      cerr << "decode: " << filename << ": truncated\n";
+      return 1;
+    }
+  }
+  delete[] buffer;
+
+  if (ferror(file)) {
+    cerr << "decode: " << filename << ": read error\n";
+    return 1;
+  }
+  if (file!=stdin) {
+    fclose(file);
+  }
+  return 0;
+}
@@ -0,0 +1,207 @@
+#define EVENTLOG_CPP
+/*********************************************************************
+Copyright 2019 James C. Hoe
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+
+#include <cstring>
+
+#include "sim.h"
+#include "arch.h"
+#include "uarch.h"
+#include "magic.h"
+#include "print.h"
+
+#include "eventlog.h"
+
+const char *eventStage[]={
+  FSTAGE, DSTAGE, ISTAGE, IkSTAGE, OSTAGE, OkSTAGE, ESTAGE, EkSTAGE, RSTAGE,
+  ":InActLST:", ":InINSTQ:",
+  NULL
+};
+
+const char *eventPrefix[]={ "", "\t\t", NULL };
+
+const char *eventSuffix[]={ "", " completed", " Readied", " 10", " 01", NULL };
+
+LONG eventIndex(const char *table[], const char *str) {
+  for(LONG i=0; table[i]; i++) {
+    if ((table[i]==str)||(!strcmp(table[i], str))) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+const char *eventString(const char *table[], ULONG idx) {
+  for(ULONG i=0; table[i]; i++) {
+    if (i==idx) {
+      return table[i];
+    }
+  }
+  return NULL;
+}
+
+void eventRender(ostream &out, const EventRecord *rec,
+		 const char *stage, const char *prefix, const char *suffix) {
+  const EventPipe *pipe=&rec->u.pipe;
+
+  out << prefix ;
+  out << "cyc" << pipe->cycle << stage << "s" << pipe->serial << "(" << (pipe->speculating) << ")";
+  out << OpCodeString[pipe->opcode];
+  if (pipe->opcode==BEQ) {
+    out << "(";
+    if (rec->flags&EVENTLOG_MISS) {
+      out << "m";
+    }
+    out << pipe->checkpoint << ")";
+  }
+  if (rec->flags&EVENTLOG_EXCEPTION) {
+    out << "Ex";
+  }
+  out << " rd=R" << (UINT)pipe->rd 
+      << " rs1=R" << (UINT)pipe->rs1 
+      << " rs2=R" << (UINT)pipe->rs2  ;
+  out << " :: td=t" << pipe->td 
+      << " ts1=t" << pipe->ts1 
+      << " ts2=t" << pipe->ts2 ;
+  out << " ";
+  for(ULONG i=0; i<rec->depth; i++) {
+    out << (((pipe->dependOn>>i)&1)?"1":"0");
+  }
+  out << suffix ;
+  out << "\n";
+}
+
+bool EventLog::qOpen() {
+  return (mFile!=NULL);
+}
+
+bool EventLog::aOpen(const char *filename) {
+  EventLogHeader header;
+
+  aClose();
+  mFilename=filename;
+  mFile=strcmp(filename, "-")?fopen(filename, "wb"):stdout;
+  mGood=(mFile!=NULL);
+  if (!mGood) {
+    cerr << "event log: " << filename << ": cannot open for writing\n";
+    return false;
+  }
+  // whole blocks go straight to the file
+  setvbuf(mFile, NULL, _IONBF, 0);
+  mWriter.aOpen(mFile);
+  mText=NULL;
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, EVENTLOG_MAGIC, sizeof(header.magic));
+  header.version=EVENTLOG_VERSION;
+  header.recordBytes=sizeof(EventRecord);
+
+  mWriter.aWrite(&header, sizeof(header));
+  return mGood;
+}
+
+void EventLog::aCapture(ostream &out) {
+  assert(!mCaptured);
+
+  mCaptured=&out;
+  mCapturedBuf=out.rdbuf(this);
+}
+
+EventRecord *EventLog::next() {
+  return (EventRecord*)mWriter.aReserve(sizeof(EventRecord));
+}
+
+void EventLog::aPipe(const EventRecord *rec) {
+  *next()=*rec;
+  mText=NULL;
+}
+
+int EventLog::overflow(int c) {
+  if (c!=EOF) {
+    char ch=c;
+    xsputn(&ch, 1);
+  }
+  return c;
+}
+
+std::streamsize EventLog::xsputn(const char *s, std::streamsize n) {
+  std::streamsize left=n;
+
+  while(left) {
+    if ((!mText)||(mText->length==EVENTLOG_TEXT_BYTES)) {
+      mText=next();
+      memset(mText, 0, sizeof(*mText));
+      mText->kind=EVENT_TEXT;
+    }
+
+    ULONG take=MIN((ULONG)left, (ULONG)(EVENTLOG_TEXT_BYTES-mText->length));
+
+    memcpy(mText->u.text+mText->length, s, take);
+    mText->length+=take;
+    s+=take;
+    left-=take;
+  }
+  return n;
+}
+
+void EventLog::aSalvage() {
+  if (mFile) {
+    mWriter.aSalvage();
+  }
+}
+
+bool EventLog::aClose() {
+  if (mCaptured) {
+    mCaptured->rdbuf(mCapturedBuf);
+    mCaptured=NULL;
+  }
+  if (mFile) {
+    mText=NULL;
+    mGood=mWriter.aClose()&&mGood;
+    if (mFile==stdout) {
+      mGood=mGood&&(!fflush(mFile));
+    } else {
+      mGood=(!fclose(mFile))&&mGood;
+    }
+    if (!mGood) {
+      cerr << "event log: " << mFilename << ": write error\n";
+    }
+    mFile=NULL;
+  }
+  return mGood;
+}
+
+////////////////////////////////////////////////////////
+//
+// Constructors
+//
+////////////////////////////////////////////////////////
+EventLog::EventLog() :
+  mFile(NULL), mFilename(NULL), mGood(false), mText(NULL),
+  mCaptured(NULL), mCapturedBuf(NULL) {
+}
+
+EventLog::~EventLog() {
+  aClose();
+}
@@ -0,0 +1,142 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+/*********************************************************************
+Copyright 2019 James C. Hoe
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+
+#include <cstdio>
+#include <streambuf>
+
+#include "sim.h"
+#include "arch.h"
+#include "logwriter.h"
+
+/*
+ * Pipeline event logs.  Instead of formatting every stage
+ * transition through iostream, prettyPrint() (see print.h) can
+ * append one fixed-size EventRecord holding the fields it would
+ * have printed.  Everything else written to cout while the log is
+ * capturing it goes into the log as text records, in order, so
+ * ooo-decode renders exactly the output the run would have printed.
+ *
+ * The file is an EventLogHeader followed by EventRecords in host
+ * byte order.  Records are written in large blocks by a thread of
+ * their own (see logwriter.h).
+ */
+
+#define EVENTLOG_MAGIC "ooo-evnt"
+#define EVENTLOG_VERSION (1)
+#define EVENTLOG_RECORD_BYTES (64)
+#define EVENTLOG_TEXT_BYTES (EVENTLOG_RECORD_BYTES-8)
+#define EVENTLOG_READ_RECORDS (1<<14)  // at a time, by ooo-decode
+
+#define EVENTLOG_MISS (1)
+#define EVENTLOG_EXCEPTION (2)
+
+typedef struct {
+  char magic[8];     // EVENTLOG_MAGIC, not terminated
+  UINT version;
+  UINT recordBytes;  // sizeof(EventRecord)
+} EventLogHeader;
+
+enum EventKind {
+  EVENT_PIPE,  // a prettyPrint() line
+  EVENT_TEXT   // length bytes of other output
+};
+
+typedef struct {
+  ULONG cycle;
+  ULONG serial;
+  ULONG speculating;
+  ULONG checkpoint;
+  ULONGLONG dependOn;  // SpeculateMask bits
+  UINT td, ts1, ts2;   // physical register indices
+  UCHAR rd, rs1, rs2;
+  UCHAR opcode;        // OpCode
+} EventPipe;
+
+typedef struct {
+  UCHAR kind;    // EventKind
+  UCHAR length;  // EVENT_TEXT: bytes of text used
+  UCHAR stage;   // EVENT_PIPE: indices into eventStage[],
+  UCHAR prefix;  // eventPrefix[] and eventSuffix[]
+  UCHAR suffix;
+  UCHAR flags;   // EVENTLOG_MISS, EVENTLOG_EXCEPTION
+  UCHAR depth;   // dependOn bits printed; UARCH_SPECULATE_DEPTH
+  UCHAR reserved;
+  union {
+    EventPipe pipe;
+    char text[EVENTLOG_TEXT_BYTES];
+  } u;
+} EventRecord;
+
+extern const char *eventStage[];
+extern const char *eventPrefix[];
+extern const char *eventSuffix[];
+
+// index of str in table (NULL-terminated); -1 if it is not there
+LONG eventIndex(const char *table[], const char *str);
+// table[idx]; NULL if past the end
+const char *eventString(const char *table[], ULONG idx);
+
+// the line prettyPrint() prints for an EVENT_PIPE record
+void eventRender(ostream &out, const EventRecord *rec,
+		 const char *stage, const char *prefix, const char *suffix);
+
+//
+// Writes an event log.  It is also a streambuf: point cout at it with
+// aCapture() to log text output as EVENT_TEXT records.
+//
+class EventLog : public std::streambuf {
+ public:
+  bool qOpen();
+
+  bool aOpen(const char *filename);
+  void aCapture(ostream &out);  // until aClose()
+  void aPipe(const EventRecord *rec);
+  bool aClose();
+  void aSalvage();  // see LogWriter
+
+  // Constructor
+  EventLog();
+  ~EventLog();
+
+ protected:
+  int overflow(int c);
+  std::streamsize xsputn(const char *s, std::streamsize n);
+
+ private:
+  FILE *mFile;
+  const char *mFilename;
+  bool mGood;
+
+  LogWriter mWriter;
+  EventRecord *mText;  // text record being filled, if any
+
+  ostream *mCaptured;
+  std::streambuf *mCapturedBuf;
+
+  EventRecord *next();
+};
+
+#endif
@@ -36,7 +36,7 @@ bool Exception::q0Pending() {
   return mPending;
 }
 
-void Exception::a6Raise(SpeculateMask mask, Cookie cookie ) {
+void Exception::a6Raise(SpeculateMask mask COOKIE_PARAM(cookie)) {
   USAGEWARN(simTock, "action before TOCK");
 
   ULONG old=0, next=0;
@@ -44,21 +44,23 @@ void Exception::a6Raise(SpeculateMask mask, Cookie cookie ) {
   if (!mPending) {
     mPending=true;
     mDependOn=mask;
+#if (DEBUG_LEVEL>=DEBUG_SILENT)
     mCookie=cookie;
+#endif
     ASSERT(cookie.inst.exception);
     return;
   }
 
-  FOR_SPECULATE_DEPTH_i {
-    old+=mDependOn.bit[i]?1:0;
-    next+=mask.bit[i]?1:0;
-  }
+  old=countSpeculation(mDependOn);
+  next=countSpeculation(mask);
 
   if (next<old) {
     ASSERT(cookie.inst.exception);
     ASSERT(cookie.serial<mCookie.serial);
     mDependOn=mask;
+#if (DEBUG_LEVEL>=DEBUG_SILENT)
     mCookie=cookie;
+#endif
   }
 #if (DEBUG_LEVEL>=DEBUG_SILENT)
   if (next==old) {
@@ -71,46 +73,32 @@ void Exception::a6Raise(SpeculateMask mask, Cookie cookie ) {
   }
 #endif
 
-  {
-    FOR_SPECULATE_DEPTH_i {
-      if (next<=old) {
-	if (mask.bit[i]) {
-	  ASSERT(mDependOn.bit[i]);
-	}
-      } else {
-	if (mDependOn.bit[i]) {
-	  ASSERT(mask.bit[i]);
-	}
-      }
-    }
+  if (next<=old) {
+    ASSERT((mask.bits&~mDependOn.bits)==0);
+  } else {
+    ASSERT((mDependOn.bits&~mask.bits)==0);
   }
 }
 
-void Exception::a6Cancel(SpeculateMask mask, Cookie cookie) {
+void Exception::a6Cancel(SpeculateMask mask COOKIE_PARAM(cookie)) {
   USAGEWARN(simTock, "action before TOCK");
 
   if (mPending) {  // okay to not check this;
-    FOR_SPECULATE_DEPTH_i {
-      if (mDependOn.bit[i] && mask.bit[i]) {
-	mPending=false;
-	ASSERT(cookie.serial<mCookie.serial);
-	ASSERT(mCookie.speculating);
-	break;
-      }
+    if (dependOnSpeculation(mDependOn, mask)) {
+      mPending=false;
+      ASSERT(cookie.serial<mCookie.serial);
+      ASSERT(mCookie.speculating);
     }
   }
 }
 
-void Exception::a6ClearMask(SpeculateMask mask, Cookie cookie) {
+void Exception::a6ClearMask(SpeculateMask mask COOKIE_PARAM(cookie)) {
   USAGEWARN(simTock, "action before TOCK");
 
   if (mPending) {  // okay to not check this;
-    FOR_SPECULATE_DEPTH_i {
-      if (mDependOn.bit[i] && mask.bit[i]) {
-	mDependOn.bit[i]=false;
-	ASSERT(cookie.serial<mCookie.serial);
-	break;
-      }
+    if (dependOnSpeculation(mDependOn, mask)) {
+      clearSpeculation(&mDependOn, mask);
+      ASSERT(cookie.serial<mCookie.serial);
     }
   }
 }
@@ -129,13 +117,17 @@ void Exception::rReset() {
 
   simTick();
 
-  FOR_SPECULATE_DEPTH_i {
-    mDependOn.bit[i]=false;
-  }
+  mDependOn=ZeroSpeculateMask;
 
   mPending=false;
 }
 
+void Exception::rSnapshot(Snapshot *snap) { 
+  SNAP(snap, mDependOn);
+  SNAP(snap, mPending);
+  SNAP(snap, mCookie);
+}
+
 void Exception::simTick() {
 }
 
@@ -26,6 +26,7 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "sim.h"
 #include "arch.h"
 #include "uarch.h"
+#include "snapshot.h"
 #include "magic.h"
 
 class Exception {
@@ -35,11 +36,12 @@ class Exception {
 
   void a0ClearPending();
 
-  void a6Raise(SpeculateMask mask, Cookie cookie);
-  void a6Cancel(SpeculateMask mask, Cookie cookie);
-  void a6ClearMask(SpeculateMask mask, Cookie cookie);
+  void a6Raise(SpeculateMask mask COOKIE_PARAM(cookie));
+  void a6Cancel(SpeculateMask mask COOKIE_PARAM(cookie));
+  void a6ClearMask(SpeculateMask mask COOKIE_PARAM(cookie));
 
   void rReset();
+  void rSnapshot(Snapshot *snap);  // save or restore all state
 
   void simTick();
 
@@ -22,6 +22,8 @@ OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
 WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 *********************************************************************/
 
+#include <cstring>
+
 #include "sim.h"
 #include "arch.h"
 #include "uarch.h"
@@ -32,79 +34,377 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
 FetchBundle Fetch::qGetInsts() {
-  for(ULONG i=mBundle.howmany; i<UARCH_DECODE_WIDTH; i++) {
+  FetchBundle bundle;
+
+  if ((mTail+UARCH_DECODE_WIDTH)>FETCH_BUFFER_SIZE) {
+    ULONG n=mTail-mHead;
+
+    memmove(mInst, mInst+mHead, n*sizeof(mInst[0]));
+    memmove(mPcLike, mPcLike+mHead, n*sizeof(mPcLike[0]));
+    memmove(mPredTaken, mPredTaken+mHead, n*sizeof(mPredTaken[0]));
+    memmove(mOparity, mOparity+mHead, n*sizeof(mOparity[0]));
+    memmove(mCookie, mCookie+mHead, n*sizeof(mCookie[0]));
+    mHead=0;
+    mTail=n;
+  }
+
+  if (mUseProducer&&(!mProducer)&&(!mHold)&&(!mReplay.qOpen())) {
+    start();
+  }
+
+  for(ULONG i=mTail; (!mHold)&&((i-mHead)<UARCH_DECODE_WIDTH); i++) {
     Biscuit biscuit;
-#if (TRACE_RANDOM)
-    Instruction ir=mTrace.getNextRandom();
-#else
-    Instruction ir=mTrace.getNextTraced();
-#endif
 
-    if (ir.opcode==HALT) break;
+    if (mReplay.qOpen()) {
+      if (!mReplay.getNext(&biscuit)) break;
+    } else {
+      if (mProducer) {
+	if (!pop(&biscuit)) break;
+      } else {
+	Instruction ir=nextInst();
 
-    mBundle.howmany++;
+	if (ir.opcode==HALT) break;
 
-    mBundle.inst[i]=ir;
+	biscuit=mMagic.aFunctional(ir);
+      }
+      if (mRecorder.qOpen()) {
+	mRecorder.aInst(biscuit);
+      }
+    }
+
+    mTail++;
+
+    mInst[i]=biscuit.inst;
 
-    biscuit=mMagic.aFunctional(ir);
 #if (DEBUG_LEVEL>=DEBUG_SILENT)
-    mBundle.cookie[i].serial=biscuit.serial;
-    mBundle.cookie[i].vd=biscuit.vd;
-    mBundle.cookie[i].vs1=biscuit.vs1;
-    mBundle.cookie[i].vs2=biscuit.vs2;
-    mBundle.cookie[i].inst=biscuit.inst;
-    mBundle.cookie[i].op=biscuit.op;
-    mBundle.cookie[i].speculating=biscuit.speculating;
+    mCookie[i].serial=biscuit.serial;
+    mCookie[i].vd=biscuit.vd;
+    mCookie[i].vs1=biscuit.vs1;
+    mCookie[i].vs2=biscuit.vs2;
+    mCookie[i].inst=biscuit.inst;
+    mCookie[i].op=biscuit.op;
+    mCookie[i].speculating=biscuit.speculating;
 #endif
-    mBundle.pcLike[i]=biscuit.serial;
+    mPcLike[i]=biscuit.serial;
 
-    mBundle.predTaken[i]=(mBundle.inst[i].miss==true)!=(biscuit.vs1==biscuit.vs2);
-    mBundle.oparity[i]=(mBundle.inst[i].exception==true)!=((popCount(biscuit.vd)%2)==1);
+    mPredTaken[i]=(mInst[i].miss==true)!=(biscuit.vs1==biscuit.vs2);
+    mOparity[i]=(mInst[i].exception==true)!=((popCount(biscuit.vd)%2)==1);
 
     // this information not available to datapath; cookie has a backup copy though
-    mBundle.inst[i].miss=true;
-    mBundle.inst[i].exception=true;
+    mInst[i].miss=true;
+    mInst[i].exception=true;
+  }
+
+  bundle.howmany=mTail-mHead;
+  bundle.inst=mInst+mHead;
+  bundle.pcLike=mPcLike+mHead;
+  bundle.predTaken=mPredTaken+mHead;
+  bundle.oparity=mOparity+mHead;
+  bundle.cookie=mCookie+mHead;
+
+  return bundle;
+}
+
+DataValue Fetch::qArchReg(LogicalRegName r) {
+  stop();
+  return mMagic.qArchReg(r);
+}
+
+ULONG Fetch::qNext() {
+  return mProducer?mNextSerial:mMagic.qSerial();
+}
+
+// the next instruction for Magic: taken back ones first
+Instruction Fetch::nextInst() {
+  ULONG serial=mMagic.qSerial();
+
+  if (serial<mRefeedEnd) {
+    return mHistory[serial%FETCH_HISTORY_SIZE].inst;
+  }
+  return mTrace.getNext();
+}
+
+//
+// Take the next biscuit of the current epoch from the ring, waiting
+// for the producer if need be; false at the end of the trace
+//
+bool Fetch::pop(Biscuit *O_Biscuit) {
+  while(!mEnded) {
+    ULONG head=mRingHead.load(std::memory_order_relaxed);
+
+    if (head==mRingTail.load(std::memory_order_acquire)) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    const FetchRingEntry *entry=&mRing[head%FETCH_RING_SIZE];
+    bool current=(entry->epoch==mEpoch);
+    bool end=entry->end;
+
+    if (current&&(!end)) {
+      *O_Biscuit=entry->biscuit;
+      mNextSerial=O_Biscuit->serial+1;
+    }
+    mRingHead.store(head+1, std::memory_order_release);
+
+    if (current) {
+      if (!end) {
+	return true;
+      }
+      mEnded=true;
+    }
+  }
+  return false;
+}
+
+// post a control to the producer; entries made before it go stale
+void Fetch::control(FetchControlKind kind, ULONG serial) {
+  ULONG seq=mControlSeq.load(std::memory_order_relaxed);
+
+  while(mControlAck.load(std::memory_order_acquire)!=seq) {
+    std::this_thread::yield();
+  }
+  mEpoch++;
+  mEnded=false;
+
+  mControl.kind=kind;
+  mControl.serial=serial;
+  mControl.next=mNextSerial;
+  mControl.epoch=mEpoch;
+  mControlSeq.store(seq+1, std::memory_order_release);
+}
+
+// on the producer: take Magic back to just before serial next
+void Fetch::unwind(ULONG next) {
+  ULONG end=mMagic.qSerial();
+
+  assert(next<=end);
+  assert((end-next)<=FETCH_HISTORY_SIZE);
+
+  while(mMagic.qSerial()>next) {
+    mMagic.aUndo(mHistory[(mMagic.qSerial()-1)%FETCH_HISTORY_SIZE]);
   }
+  mRefeedEnd=MAX(mRefeedEnd, end);
+}
+
+void Fetch::start() {
+  assert(mHead==mTail);
 
-  return mBundle;
+  mRingHead.store(0);
+  mRingTail.store(0);
+  mControlSeq.store(0);
+  mControlAck.store(0);
+  mNextSerial=mMagic.qSerial();
+  mEnded=false;
+
+  // runs under the configuration installed on this thread
+  mProducer=new std::thread(&Fetch::produce, this, uarchConfig, traceConfig);
+}
+
+// leaves Magic as if it had only made what was offered
+void Fetch::stop() {
+  if (!mProducer) {
+    return;
+  }
+  control(FETCH_STOP, 0);
+  mProducer->join();
+  delete mProducer;
+  mProducer=NULL;
+}
+
+void Fetch::produce(UArchConfig uarch, TraceConfig trace) {
+  ULONG seen=0;
+  ULONG epoch=mEpoch;
+  bool ended=false;
+
+  uarchConfig=uarch;
+  traceConfig=trace;
+
+  for(;;) {
+    ULONG seq=mControlSeq.load(std::memory_order_acquire);
+
+    if (seq!=seen) {
+      FetchControl ctrl=mControl;
+
+      seen=seq;
+      unwind(ctrl.next);
+      if (ctrl.kind==FETCH_STOP) {
+	mControlAck.store(seq, std::memory_order_release);
+	return;
+      }
+      if (ctrl.kind==FETCH_REWIND) {
+	mMagic.aRewind(ctrl.serial);
+      } else {
+	mMagic.aRestart(ctrl.serial);
+      }
+      epoch=ctrl.epoch;
+      ended=false;
+      mControlAck.store(seq, std::memory_order_release);
+      continue;
+    }
+
+    ULONG tail=mRingTail.load(std::memory_order_relaxed);
+
+    if (ended||
+	((tail-mRingHead.load(std::memory_order_acquire))==FETCH_RING_SIZE)) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    FetchRingEntry *entry=&mRing[tail%FETCH_RING_SIZE];
+    Instruction ir=nextInst();
+
+    entry->epoch=epoch;
+    entry->end=(ir.opcode==HALT);
+    if (!entry->end) {
+      entry->biscuit=mMagic.aFunctional(ir);
+      mHistory[entry->biscuit.serial%FETCH_HISTORY_SIZE]=entry->biscuit;
+    }
+    ended=entry->end;
+    mRingTail.store(tail+1, std::memory_order_release);
+  }
+}
+
+//
+// Run up to n instructions through Magic alone, before anything is
+// fetched for the datapath
+//
+ULONG Fetch::aFastForward(ULONG n) {
+  ULONG i;
+
+  assert(mHead==mTail);
+  stop();
+
+  for(i=0; i<n; i++) {
+    Instruction ir=nextInst();
+
+    if (ir.opcode==HALT) break;
+
+    mMagic.aFastForward(ir);
+  }
+
+  return i;
+}
+
+void Fetch::aHold(bool hold) {
+  mHold=hold;
+}
+
+bool Fetch::qWaiting() {
+  return mReplay.qOpen()&&mReplay.qWaiting();
+}
+
+bool Fetch::qFailed() {
+  stop();
+  return mTrace.qFailed()||mReplay.qFailed();
+}
+
+bool Fetch::aRecord(const char *filename) {
+  return mRecorder.aOpen(filename);
+}
+
+bool Fetch::aReplay(const char *filename) {
+  return mReplay.aOpen(filename);
+}
+
+void Fetch::aProducer(ULONG mode) {
+  mUseProducer=FETCH_PRODUCER&&
+    ((mode==FETCH_PRODUCER_ON)||
+     ((mode==FETCH_PRODUCER_AUTO)&&(std::thread::hardware_concurrency()>1)));
 }
 
 void Fetch::aAccept(ULONG n) {
   assert(n<=UARCH_DECODE_WIDTH);
-  assert(n<=mBundle.howmany);
+  assert(n<=(mTail-mHead));
 
-  for(ULONG i=0, j=n; j<mBundle.howmany; i++,j++) {
-    mBundle.inst[i]=mBundle.inst[j];
-    mBundle.cookie[i]=mBundle.cookie[j];
-    mBundle.pcLike[i]=mBundle.pcLike[j];
-    mBundle.predTaken[i]=mBundle.predTaken[j];
-    mBundle.oparity[i]=mBundle.oparity[j];
+  mHead+=n;
+  if (mHead==mTail) {
+    mHead=0;
+    mTail=0;
   }
-
-  mBundle.howmany=mBundle.howmany-n;
 }
 
 void Fetch::aRewind(ULONG serial) {
+  if (mReplay.qOpen()) {
+    mReplay.aRedirect(FETCHREC_REWIND, serial);
+  }
 #if (DEBUG_LEVEL>=DEBUG_FULL)
-  cout << "cyc" << (simTimer/TICK_CYC) << " ******************* rewinding to s" << serial << " continue from s" << mMagic.qSerial() << "*******************\n";
+  cout << "cyc" << (simTimer/TICK_CYC) << " ******************* rewinding to s" << serial << " continue from s" << (mReplay.qOpen()?mReplay.qResume():qNext()) << "*******************\n";
 #endif
-  mMagic.aRewind(serial);
-  mBundle.howmany=0;
+  if (!mReplay.qOpen()) {
+    if (mRecorder.qOpen()) {
+      mRecorder.aRedirect(FETCHREC_REWIND, serial, qNext());
+    }
+    if (mProducer) {
+      control(FETCH_REWIND, serial);
+    } else {
+      mMagic.aRewind(serial);
+    }
+  }
+  mHead=0;
+  mTail=0;
 }
 
 void Fetch::aRestart(ULONG serial) {
+  if (mReplay.qOpen()) {
+    mReplay.aRedirect(FETCHREC_RESTART, serial);
+  }
 #if (DEBUG_LEVEL>=DEBUG_FULL)
-  cout << "cyc" << (simTimer/TICK_CYC) << " ******************* restarting to s" << serial << " continue from s" << mMagic.qSerial() << "*******************\n";
+  cout << "cyc" << (simTimer/TICK_CYC) << " ******************* restarting to s" << serial << " continue from s" << (mReplay.qOpen()?mReplay.qResume():qNext()) << "*******************\n";
 #endif
-  mMagic.aRestart(serial);
-  mBundle.howmany=0;
+  if (!mReplay.qOpen()) {
+    if (mRecorder.qOpen()) {
+      mRecorder.aRedirect(FETCHREC_RESTART, serial, qNext());
+    }
+    if (mProducer) {
+      control(FETCH_RESTART, serial);
+    } else {
+      mMagic.aRestart(serial);
+    }
+  }
+  mHead=0;
+  mTail=0;
 }
 
 void Fetch::rReset() {
+  stop();
   mMagic.rReset();
   mTrace.rReset();
 
-  mBundle.howmany=0;
+  mHead=0;
+  mTail=0;
+  mHold=false;
+  mRefeedEnd=0;
+}
+
+void Fetch::rSnapshot(Snapshot *snap) {
+  stop();
+  mTrace.rSnapshot(snap);
+  mMagic.rSnapshot(snap);
+
+  SNAP(snap, mInst);
+  SNAP(snap, mPcLike);
+  SNAP(snap, mPredTaken);
+  SNAP(snap, mOparity);
+  SNAP(snap, mCookie);
+  SNAP(snap, mHead);
+  SNAP(snap, mTail);
+  SNAP(snap, mHold);
+
+  if ((!snap->qSaving())&&((mHead>mTail)||(mTail>FETCH_BUFFER_SIZE))) {
+    snap->aFail("corrupt fetch buffer");
+  }
+
+  // only the instructions still to be fed again are live
+  SNAP(snap, mRefeedEnd);
+  if ((mRefeedEnd>mMagic.qSerial())&&
+      ((mRefeedEnd-mMagic.qSerial())>FETCH_HISTORY_SIZE)) {
+    snap->aFail("corrupt fetch history");
+    return;
+  }
+  for(ULONG serial=mMagic.qSerial(); serial<mRefeedEnd; serial++) {
+    SNAP(snap, mHistory[serial%FETCH_HISTORY_SIZE]);
+  }
 }
 
 ////////////////////////////////////////////////////////
@@ -112,7 +412,13 @@ void Fetch::rReset() {
 // Constructors
 //
 ////////////////////////////////////////////////////////
-Fetch::Fetch() {
+Fetch::Fetch() :
+  mUseProducer(false), mProducer(NULL), mRingHead(0), mRingTail(0),
+  mControlSeq(0), mControlAck(0), mEpoch(0), mNextSerial(0), mEnded(false) {
   rReset();
 }
 
+Fetch::~Fetch() {
+  stop();
+}
+
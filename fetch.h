@@ -23,42 +23,151 @@ OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
 WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 *********************************************************************/
 
+#include <atomic>
+#include <thread>
+
 #include "sim.h"
 #include "arch.h"
 #include "uarch.h"
+#include "snapshot.h"
 #include "magic.h"
 
 #include "trace.h"
+#include "fetchrec.h"
+
+//
+// Fetched instructions wait in a buffer from mHead to mTail.
+// aAccept() only advances mHead; qGetInsts() moves what is left (at
+// most a bundle) back to the front when there is no room after mTail
+// for a full bundle, which takes at least
+// FETCH_BUFFER_SIZE-2*UARCH_DECODE_WIDTH accepted instructions.
+//
+#define FETCH_BUFFER_SIZE (4*UARCH_MAX_DECODE_WIDTH)
+
+//
+// Trace and Magic can run on a producer thread of their own, up to
+// FETCH_RING_SIZE instructions ahead, handing Biscuits to qGetInsts()
+// through a single-producer/single-consumer ring.  qGetInsts() still
+// waits for as many instructions as it would have taken itself, so
+// timing is the same with or without the producer.
+//
+// A rewind or restart is passed to the producer as a FetchControl.
+// The producer first takes back (Magic::aUndo()) everything past what
+// was offered to the datapath, then redirects Magic; the instructions
+// taken back are fed again from mHistory, since Trace cannot go back.
+// Ring entries carry the epoch they were made in, and qGetInsts()
+// drops those of an epoch already redirected away from.
+//
+// The producer is stopped the same way (FETCH_STOP) before anything
+// else looks at Trace or Magic, and is started again by the next
+// qGetInsts().  It is not used at DEBUG_TRACE, where Magic prints.
+//
+#define FETCH_PRODUCER (DEBUG_LEVEL!=DEBUG_TRACE)
+#define FETCH_RING_SIZE (MAGIC_RUNAHEAD)
+#define FETCH_HISTORY_SIZE (2*FETCH_RING_SIZE)
+
+#define FETCH_PRODUCER_OFF (0)
+#define FETCH_PRODUCER_AUTO (1)  // if the host has more than 1 hardware thread
+#define FETCH_PRODUCER_ON (2)
+
+typedef struct {
+  Biscuit biscuit;
+  ULONG epoch;
+  bool end;  // the trace ran out; no biscuit
+} FetchRingEntry;
+
+typedef enum {
+  FETCH_REWIND,
+  FETCH_RESTART,
+  FETCH_STOP
+} FetchControlKind;
 
+typedef struct {
+  FetchControlKind kind;
+  ULONG serial;  // of the rewind or restart
+  ULONG next;    // serial after the last one offered to the datapath
+  ULONG epoch;   // of the ring entries made from here on
+} FetchControl;
+
+//
+// A view of the instructions offered for decode: howmany entries
+// from each pointer, valid until the next Fetch action
+//
 typedef struct {
   ULONG howmany;
-  Instruction inst[UARCH_DECODE_WIDTH];
-  ULONG pcLike[UARCH_DECODE_WIDTH];
-  bool predTaken[UARCH_DECODE_WIDTH];
-  bool oparity[UARCH_DECODE_WIDTH];
-  Cookie cookie[UARCH_DECODE_WIDTH];
+  const Instruction *inst;
+  const ULONG *pcLike;
+  const bool *predTaken;
+  const bool *oparity;
+  const Cookie *cookie;
 } FetchBundle;
 
 class Fetch {
  public:
   FetchBundle qGetInsts();
+  DataValue qArchReg(LogicalRegName r);
   
+  ULONG aFastForward(ULONG n);  // returns no. of instructions taken
+  void aHold(bool hold);        // stop taking new trace instructions
+  bool qWaiting();              // replay stopped at a recorded redirect
+  bool qFailed();               // the trace or replay could not be read
+  bool aRecord(const char *filename);  // after rReset()
+  bool aReplay(const char *filename);  // after rReset(); instead of
+				       // Trace and Magic
+  void aProducer(ULONG mode);          // FETCH_PRODUCER_*
   void aAccept(ULONG n);
   void aRewind(ULONG serial);
   void aRestart(ULONG serial);
 
   void rReset();
+  void rSnapshot(Snapshot *snap);  // save or restore all state
 
   void simTick();
 
   // Constructor
   Fetch();
+  ~Fetch();
 
  private:
   Trace mTrace;
   Magic mMagic;
 
-  FetchBundle mBundle;
+  FetchRecorder mRecorder;
+  FetchReplay mReplay;
+
+  Instruction mInst[FETCH_BUFFER_SIZE];
+  ULONG mPcLike[FETCH_BUFFER_SIZE];
+  bool mPredTaken[FETCH_BUFFER_SIZE];
+  bool mOparity[FETCH_BUFFER_SIZE];
+  Cookie mCookie[FETCH_BUFFER_SIZE];
+  ULONG mHead;  // oldest unaccepted
+  ULONG mTail;  // next free
+  bool mHold;
+
+  // taken back from Magic, to be fed again before Trace; by serial
+  Biscuit mHistory[FETCH_HISTORY_SIZE];
+  ULONG mRefeedEnd;
+
+  bool mUseProducer;
+  std::thread *mProducer;  // NULL if not running
+  FetchRingEntry mRing[FETCH_RING_SIZE];
+  alignas(64) std::atomic<ULONG> mRingHead;  // advanced by qGetInsts()
+  alignas(64) std::atomic<ULONG> mRingTail;  // advanced by the producer
+  alignas(64) FetchControl mControl;
+  std::atomic<ULONG> mControlSeq;  // controls posted
+  std::atomic<ULONG> mControlAck;  // controls carried out
+  ULONG mEpoch;
+  ULONG mNextSerial;  // after the last biscuit taken from the ring
+  bool mEnded;        // took the end of the trace in this epoch
+
+  ULONG qNext();  // serial after the last one offered to the datapath
+  Instruction nextInst();
+  bool pop(Biscuit *O_Biscuit);
+  void control(FetchControlKind kind, ULONG serial);
+  void unwind(ULONG next);
+  void start();
+  void stop();
+  void produce(UArchConfig uarch, TraceConfig trace);
 };
 
 
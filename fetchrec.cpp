@@ -0,0 +1,265 @@
+#define FETCHREC_CPP
+/*********************************************************************
+Copyright 2019 James C. Hoe
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+
+#include <cstring>
+
+#include "sim.h"
+#include "arch.h"
+#include "magic.h"
+#include "tracefile.h"
+#include "fetchrec.h"
+
+bool FetchRecorder::qOpen() {
+  return (mFile!=NULL);
+}
+
+void FetchRecorder::write(const void *data, ULONG bytes) {
+  if (mGood) {
+    mGood=(fwrite(data, bytes, 1, mFile)==1);
+  }
+}
+
+bool FetchRecorder::aOpen(const char *filename) {
+  FetchRecordHeader header;
+
+  aClose();
+  mFilename=filename;
+  mFile=strcmp(filename, "-")?fopen(filename, "wb"):stdout;
+  mGood=(mFile!=NULL);
+  if (!mGood) {
+    cerr << "record: " << filename << ": cannot open for writing\n";
+    return false;
+  }
+  if (mFile!=stdout) {
+    setvbuf(mFile, NULL, _IOFBF, FETCHREC_BUFFER);
+  }
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, FETCHREC_MAGIC, sizeof(header.magic));
+  header.version=FETCHREC_VERSION;
+  header.recordBytes=sizeof(FetchRecord);
+
+  write(&header, sizeof(header));
+  return mGood;
+}
+
+void FetchRecorder::aInst(Biscuit biscuit) {
+  FetchRecord rec;
+
+  memset(&rec, 0, sizeof(rec));
+  rec.kind=FETCHREC_INST;
+  rec.opcode=biscuit.inst.opcode;
+  rec.rd=biscuit.inst.rd;
+  rec.rs1=biscuit.inst.rs1;
+  rec.rs2=biscuit.inst.rs2;
+  rec.flags=(biscuit.inst.miss?TRACEFILE_MISS:0)|(biscuit.inst.exception?TRACEFILE_EXCEPTION:0);
+  rec.serial=biscuit.serial;
+  rec.speculating=biscuit.speculating;
+  rec.vd=biscuit.vd;
+  rec.vs1=biscuit.vs1;
+  rec.vs2=biscuit.vs2;
+
+  write(&rec, sizeof(rec));
+}
+
+void FetchRecorder::aRedirect(FetchRecordKind kind, ULONG serial, ULONG resume) {
+  FetchRecord rec;
+
+  memset(&rec, 0, sizeof(rec));
+  rec.kind=kind;
+  rec.serial=serial;
+  rec.speculating=resume;
+
+  write(&rec, sizeof(rec));
+}
+
+bool FetchRecorder::aClose() {
+  if (mFile) {
+    if (mFile==stdout) {
+      mGood=mGood&&(!fflush(mFile));
+    } else {
+      mGood=(!fclose(mFile))&&mGood;
+    }
+    if (!mGood) {
+      cerr << "record: " << mFilename << ": write error\n";
+    }
+    mFile=NULL;
+  }
+  return mGood;
+}
+
+bool FetchReplay::qOpen() {
+  return (mFile!=NULL);
+}
+
+bool FetchReplay::qFailed() {
+  return mFailed;
+}
+
+// read ahead one record; false at the end
+bool FetchReplay::peek() {
+  if (mHave) {
+    return true;
+  }
+  if (mFailed) {
+    return false;
+  }
+  if (fread(&mNext, sizeof(mNext), 1, mFile)!=1) {
+    return false;
+  }
+
+  if ((mNext.kind>FETCHREC_RESTART)||
+      ((mNext.kind==FETCHREC_INST)&&
+       (((mNext.opcode!=ADD)&&(mNext.opcode!=BEQ))||
+	(mNext.rd>=ARCH_NUM_LOGICAL_REG)||
+	(mNext.rs1>=ARCH_NUM_LOGICAL_REG)||
+	(mNext.rs2>=ARCH_NUM_LOGICAL_REG)))) {
+    cerr << "replay: " << mFilename << ": bad record\n";
+    mFailed=true;
+    return false;
+  }
+
+  mHave=true;
+  return true;
+}
+
+bool FetchReplay::qWaiting() {
+  return peek()&&(mNext.kind!=FETCHREC_INST);
+}
+
+ULONG FetchReplay::qResume() {
+  return mResume;
+}
+
+bool FetchReplay::getNext(Biscuit *O_Biscuit) {
+  if ((!peek())||(mNext.kind!=FETCHREC_INST)) {
+    return false;
+  }
+  mHave=false;
+
+  memset(O_Biscuit, 0, sizeof(*O_Biscuit));
+  O_Biscuit->serial=mNext.serial;
+  O_Biscuit->speculating=mNext.speculating;
+  O_Biscuit->inst.opcode=(OpCode)mNext.opcode;
+  O_Biscuit->inst.rd=(LogicalRegName)mNext.rd;
+  O_Biscuit->inst.rs1=(LogicalRegName)mNext.rs1;
+  O_Biscuit->inst.rs2=(LogicalRegName)mNext.rs2;
+  O_Biscuit->inst.miss=((mNext.flags&TRACEFILE_MISS)!=0);
+  O_Biscuit->inst.exception=((mNext.flags&TRACEFILE_EXCEPTION)!=0);
+  O_Biscuit->vd=mNext.vd;
+  O_Biscuit->vs1=mNext.vs1;
+  O_Biscuit->vs2=mNext.vs2;
+
+  return true;
+}
+
+//
+// Move past the recorded redirect the datapath just made.  Recorded
+// instructions and younger redirects before it were on a wrong path
+// the datapath left sooner.  A redirect younger than the next
+// recorded one is itself on that one's wrong path, whose unrecorded
+// remainder is not replayed: fetch waits for the older redirect.
+//
+void FetchReplay::aRedirect(FetchRecordKind kind, ULONG serial) {
+  while(peek()) {
+    if (mNext.kind!=FETCHREC_INST) {
+      if ((mNext.kind==kind)&&(mNext.serial==serial)) {
+	mResume=mNext.speculating;
+	mHave=false;
+	return;
+      }
+      if (mNext.serial<serial) {
+	mResume=mNext.speculating;
+	return;
+      }
+      if (mNext.serial==serial) {
+	break;
+      }
+    }
+    mHave=false;
+  }
+  if (mFailed) {
+    return;
+  }
+
+  cerr << "replay: " << mFilename << ": the datapath left the recorded path at a " 
+       << ((kind==FETCHREC_REWIND)?"rewind":"restart") << " to s" << serial << "\n";
+  mHave=false;
+  mFailed=true;
+}
+
+bool FetchReplay::aOpen(const char *filename) {
+  FetchRecordHeader header;
+
+  aClose();
+  mFilename=filename;
+  mFile=strcmp(filename, "-")?fopen(filename, "rb"):stdin;
+  if (!mFile) {
+    cerr << "replay: " << filename << ": cannot open\n";
+    return false;
+  }
+  setvbuf(mFile, NULL, _IOFBF, FETCHREC_BUFFER);
+
+  if ((fread(&header, sizeof(header), 1, mFile)!=1)||
+      strncmp(header.magic, FETCHREC_MAGIC, sizeof(header.magic))||
+      (header.version!=FETCHREC_VERSION)||
+      (header.recordBytes!=sizeof(FetchRecord))) {
+    cerr << "replay: " << filename << ": not a fetch recording of this version\n";
+    aClose();
+    return false;
+  }
+
+  return true;
+}
+
+void FetchReplay::aClose() {
+  if (mFile&&(mFile!=stdin)) {
+    fclose(mFile);
+  }
+  mFile=NULL;
+  mHave=false;
+  mResume=0;
+  mFailed=false;
+}
+
+////////////////////////////////////////////////////////
+//
+// Constructors
+//
+////////////////////////////////////////////////////////
+FetchRecorder::FetchRecorder() : mFile(NULL), mFilename(NULL), mGood(false) {
+}
+
+FetchRecorder::~FetchRecorder() {
+  aClose();
+}
+
+FetchReplay::FetchReplay() : mFile(NULL), mFilename(NULL) {
+  aClose();
+}
+
+FetchReplay::~FetchReplay() {
+  aClose();
+}
@@ -0,0 +1,127 @@
+#ifndef FETCHREC_H
+#define FETCHREC_H
+/*********************************************************************
+Copyright 2019 James C. Hoe
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+#include <cstdio>
+
+#include "sim.h"
+#include "arch.h"
+#include "magic.h"
+
+/*
+ * Fetch recordings.  A recording holds the exact stream Fetch fed
+ * the datapath in one run: every instruction as Magic executed it
+ * (wrong-path ones included) and every rewind and restart, in the
+ * order they happened.  The file is a FetchRecordHeader followed by
+ * one FetchRecord per instruction or redirect, in host byte order.
+ *
+ * A replay feeds the recorded instructions back without Trace or
+ * Magic.  It stops at a recorded redirect until the datapath asks
+ * for it.  If the datapath redirects sooner, e.g. because the
+ * backend under test resolves the branch earlier, the recorded
+ * instructions up to that redirect were on the wrong path and are
+ * skipped.  If the datapath first redirects to a branch on the wrong
+ * path of the next recorded redirect, fetch offers nothing until
+ * that redirect comes.  Any other redirect means the datapath left
+ * the recorded path, and ends the replay.
+ */
+
+#define FETCHREC_MAGIC "ooofetch"
+#define FETCHREC_VERSION (1)
+#define FETCHREC_BUFFER (1<<16)  // bytes of stdio buffering
+
+typedef struct {
+  char magic[8];     // FETCHREC_MAGIC, not terminated
+  UINT version;
+  UINT recordBytes;  // sizeof(FetchRecord)
+} FetchRecordHeader;
+
+enum FetchRecordKind {
+  FETCHREC_INST,
+  FETCHREC_REWIND,
+  FETCHREC_RESTART
+};
+
+typedef struct {
+  UCHAR kind;         // FetchRecordKind
+  UCHAR opcode;       // OpCode
+  UCHAR rd, rs1, rs2;
+  UCHAR flags;        // TRACEFILE_MISS, TRACEFILE_EXCEPTION
+  UCHAR reserved[2];
+  ULONG serial;       // of the instruction, or redirected to
+  ULONG speculating;  // of the instruction, or serial fetch
+		      // continues from after the redirect
+  DataValue vd, vs1, vs2;
+} FetchRecord;
+
+class FetchRecorder {
+ public:
+  bool qOpen();
+
+  bool aOpen(const char *filename);
+  void aInst(Biscuit biscuit);
+  void aRedirect(FetchRecordKind kind, ULONG serial, ULONG resume);
+  bool aClose();
+
+  // Constructor
+  FetchRecorder();
+  ~FetchRecorder();
+
+ private:
+  FILE *mFile;
+  const char *mFilename;
+  bool mGood;
+
+  void write(const void *data, ULONG bytes);
+};
+
+class FetchReplay {
+ public:
+  bool qOpen();
+  bool qFailed();    // bad record or left the recorded path; ended there
+  bool qWaiting();   // stopped at a redirect the datapath has not made
+  ULONG qResume();   // serial fetch continues from, after aRedirect()
+
+  bool getNext(Biscuit *O_Biscuit);  // false if waiting or at the end
+  void aRedirect(FetchRecordKind kind, ULONG serial);
+
+  bool aOpen(const char *filename);
+  void aClose();
+
+  // Constructor
+  FetchReplay();
+  ~FetchReplay();
+
+ private:
+  FILE *mFile;
+  const char *mFilename;
+  FetchRecord mNext;  // read ahead
+  bool mHave;         // mNext is valid
+  ULONG mResume;
+  bool mFailed;
+
+  bool peek();
+};
+
+#endif
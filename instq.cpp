@@ -31,6 +31,8 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "instq.h"
 #include "checkpoint.h"
+#include "cam.h"
+
 
 ////////////////////////////////////////////////////////
 //
@@ -38,7 +40,8 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //
 ////////////////////////////////////////////////////////
 
-ULONG InstQ::q2NumSlots() {
+template<class UArch>
+ULONG InstQ<UArch>::q2NumSlots() {
   USAGEWARN((!simTock), "query after TOCK");
 
   ASSERT (mInUse<=UARCH_INSTQ_SIZE);
@@ -46,167 +49,324 @@ ULONG InstQ::q2NumSlots() {
   return (UARCH_INSTQ_SIZE-mInUse);
 }
 
-InstQEntry InstQ::q4Readied() {
+template<class UArch>
+InstQEntry InstQ<UArch>::q4Readied() {
   USAGEWARN((!simTock), "query after TOCK");
   USAGEWARN(((dNumReadied++)<MAX_INSTQ_READY), "exceeding number of InstQ ready CAM-read port limit\n");
   printState();
 
-  LONG which=-1;
-  mScan=MSCANSTART;
-  if (mInUse) {
-    FOR_INSTQ_SIZE_i {
-      if ((mArray[mScan].valid) &&
-	  (mArray[mScan].ts1Ready) &&
-	  (mArray[mScan].ts2Ready)) {
-	which=mScan; 
-	break;
-      }
-      mScan++;
-      mScan%=UARCH_INSTQ_SIZE;
-    } 
-  }
+  ULONG slot;
 
-  if (which==-1) {
+  mScan=MSCANSTART;
+  if (!slotPick(mReady, mScan, &slot)) {
     return invalidEntryInstQ;
   } else {
     ASSERT(mInUse);
-    return mArray[which];
+    mScan=slot;
+    return entry(slot);
   }
 }
 
 
-void InstQ::a3Insert(ULONG atag, Operation op, 
-		     bool ts1Busy, bool ts2Busy, 
-		     Cookie cookie) {
+template<class UArch>
+void InstQ<UArch>::a3Insert(ULONG atag, Operation op, 
+		     bool ts1Busy, bool ts2Busy
+		     COOKIE_PARAM(cookie)) {
   USAGEWARN(simTock, "action before TOCK");
   USAGEWARN(((dNumInsert++)<MAX_INSTQ_INSERT), "exceeding number of InstQ insert write port limit\n");
 
   ASSERT(mInUse<(UARCH_INSTQ_SIZE));
 
+  // first free slot in scan order
+  for(ULONG w=0; w<INSTQ_SLOT_WORDS; w++) {
+    mMatch1[w]=~mValid[w];
+  }
+  if (UARCH_INSTQ_SIZE%INSTQ_SLOT_WORD_BITS) {
+    mMatch1[INSTQ_SLOT_WORDS-1]&=(((ULONGLONG)1)<<(UARCH_INSTQ_SIZE%INSTQ_SLOT_WORD_BITS))-1;
+  }
+
+  ULONG slot;
   mScan=MSCANSTART;
-  FOR_INSTQ_SIZE_i {
-    if (!mArray[mScan].valid) {
-      mInUse++;
-      mArray[mScan].valid=1;
-      
-      mArray[mScan].atag=atag;
-      mArray[mScan].op=op;
-      mArray[mScan].ts1Ready=!ts1Busy;
-      mArray[mScan].ts2Ready=!ts2Busy;
-      mArray[mScan].cookie=cookie;
-      mScan++;
-      mScan%=UARCH_INSTQ_SIZE;
-      return;
+  if (!slotPick(mMatch1, mScan, &slot)) {
+    ASSERT(0);
+    return;
+  }
+
+  mInUse++;
+  bitvecSet(mValid, slot);
+  mAtag[slot]=atag;
+  mOp[slot]=op;
+#if (DEBUG_LEVEL>=DEBUG_SILENT)
+  mCookie[slot]=cookie;
+#endif
+  mTs1Key[slot]=tagKey(op.ts1);
+  mTs2Key[slot]=tagKey(op.ts2);
+  mDependOn[slot]=op.dependOn.bits;
+  if (ts1Busy) {
+    bitvecClear(mTs1Ready, slot);
+  } else {
+    bitvecSet(mTs1Ready, slot);
+  }
+  if (ts2Busy) {
+    bitvecClear(mTs2Ready, slot);
+  } else {
+    bitvecSet(mTs2Ready, slot);
+  }
+  readyUpdate(slot/INSTQ_SLOT_WORD_BITS);
+
+  if (INSTQ_WAKEUP_MATRIX) {
+    if (ts1Busy) {
+      ASSERT(!tagEqual(op.ts1, ZeroRegTag));
+      bitvecSet(wakeupRow(mWakeup1, op.ts1), slot);
     }
-    mScan++;
-    mScan%=UARCH_INSTQ_SIZE;
-  } 
-  ASSERT(0);
+    if (ts2Busy) {
+      ASSERT(!tagEqual(op.ts2, ZeroRegTag));
+      bitvecSet(wakeupRow(mWakeup2, op.ts2), slot);
+    }
+  }
+
+  mScan=(slot+1)%UARCH_INSTQ_SIZE;
 }
 
-void InstQ::a4Issue(ULONG which) {
+template<class UArch>
+void InstQ<UArch>::a4Issue(ULONG which) {
   USAGEWARN(simTock, "action before TOCK");
   USAGEWARN(((dNumIssue++)<MAX_INSTQ_ISSUE), "exceeding number of InstQ issue set port limit\n");
 
   ASSERT(which<UARCH_INSTQ_SIZE);
-  ASSERT(mArray[which].valid);
+  ASSERT(bitvecIsSet(mValid, which));
+  ASSERT(bitvecIsSet(mReady, which)); // on no wakeup row
   ASSERT(mInUse);
 
-  prettyPrint(ISTAGE,mArray[which].op,mArray[which].cookie);
-  mArray[which].valid=0;
+  prettyPrint(ISTAGE,entryOp(which),mCookie[which]);
+  bitvecClear(mValid, which);
   mInUse--;
+  readyUpdate(which/INSTQ_SLOT_WORD_BITS);
 }
 
-void InstQ::a4Release(RenameTag which, Cookie cookie) {
+template<class UArch>
+void InstQ<UArch>::a4Release(RenameTag which COOKIE_PARAM(cookie)) {
 
   USAGEWARN(simTock, "action before TOCK");
   USAGEWARN(((dNumRelease++)<MAX_INSTQ_RELEASE), "exceeding number of InstQ release CAM-write  port limit\n");
 
   //cout << "rforwarding t" << which.idx << "\n"; 
 
-  if (!tagEqual(which, ZeroRegTag)) {
-    FOR_INSTQ_SIZE_i {
-      if (tagEqual(mArray[i].op.ts1,which)) { 
-	if (mArray[i].valid) {
-	  ASSERT(mArray[i].cookie.serial>cookie.serial);
-	  ASSERT(!mArray[i].ts1Ready);
-	}
-	mArray[i].ts1Ready=true;
-      }
-      if (tagEqual(mArray[i].op.ts2,which)) {
-	if (mArray[i].valid) {
-	  ASSERT(mArray[i].cookie.serial>cookie.serial);
-	  ASSERT(!mArray[i].ts2Ready);
-	}
-	mArray[i].ts2Ready=true;
-      }
-    } 
+  if (tagEqual(which, ZeroRegTag)) {
+    return;
+  }
+
+  ULONGLONG *waiting1, *waiting2;
+
+  if (INSTQ_WAKEUP_MATRIX) {
+    waiting1=wakeupRow(mWakeup1, which);
+    waiting2=wakeupRow(mWakeup2, which);
+  } else {
+    camMatchEqual(mTs1Key, INSTQ_SLOT_WORDS*INSTQ_SLOT_WORD_BITS, tagKey(which), mMatch1);
+    camMatchEqual(mTs2Key, INSTQ_SLOT_WORDS*INSTQ_SLOT_WORD_BITS, tagKey(which), mMatch2);
+    waiting1=mMatch1;
+    waiting2=mMatch2;
+  }
+
+  for(ULONG w=0; w<INSTQ_SLOT_WORDS; w++) {
+#if (DEBUG_LEVEL>=DEBUG_SILENT)
+    for(ULONGLONG bits=(waiting1[w]|waiting2[w])&mValid[w]; bits; bits&=(bits-1)) {
+      ULONG i=w*INSTQ_SLOT_WORD_BITS+__builtin_ctzll(bits);
+      ASSERT(mCookie[i].serial>cookie.serial);
+    }
+#endif
+    ASSERT((waiting1[w]&mValid[w]&mTs1Ready[w])==0);
+    ASSERT((waiting2[w]&mValid[w]&mTs2Ready[w])==0);
+    if (INSTQ_WAKEUP_MATRIX) {
+      ASSERT((waiting1[w]&~mValid[w])==0);
+      ASSERT((waiting2[w]&~mValid[w])==0);
+    }
+
+    mTs1Ready[w]|=waiting1[w];
+    mTs2Ready[w]|=waiting2[w];
+    readyUpdate(w);
+
+    if (INSTQ_WAKEUP_MATRIX) {
+      waiting1[w]=0;
+      waiting2[w]=0;
+    }
   }
 }
 
-void InstQ::a6Squash(SpeculateMask mask, Cookie cookie) {
+template<class UArch>
+void InstQ<UArch>::a6Squash(SpeculateMask mask COOKIE_PARAM(cookie)) {
   USAGEWARN(simTock, "action before TOCK");
   USAGEWARN(((dNumSquash++)<MAX_INSTQ_SQUASH), "exceeding number of InstQ squash CAM-clear port limit\n");
 
   ASSERT(maskIsSetOnceSpeculation(mask));
 	 
-  FOR_INSTQ_SIZE_i {
-    if (mArray[i].valid) {
-      if (dependOnSpeculation(mArray[i].op.dependOn, mask)) {
-	ASSERT(mArray[i].cookie.serial>cookie.serial);
-	// squashed
-	prettyPrint(IkSTAGE,mArray[i].op,mArray[i].cookie);
-	mArray[i].valid=false;
-	mInUse--;
+  camMatchAny(mDependOn, INSTQ_SLOT_WORDS*INSTQ_SLOT_WORD_BITS, mask.bits, mMatch1);
+
+  for(ULONG w=0; w<INSTQ_SLOT_WORDS; w++) {
+    ULONGLONG squashed=mMatch1[w]&mValid[w];
+
+    for(ULONGLONG bits=squashed; bits; bits&=(bits-1)) {
+      ULONG i=w*INSTQ_SLOT_WORD_BITS+__builtin_ctzll(bits);
+      ASSERT(mCookie[i].serial>cookie.serial);
+      prettyPrint(IkSTAGE,entryOp(i),mCookie[i]);
+      if (INSTQ_WAKEUP_MATRIX) {
+	if (!bitvecIsSet(mTs1Ready, i)) {
+	  ASSERT(bitvecIsSet(wakeupRow(mWakeup1, keyTag(mTs1Key[i])), i));
+	  bitvecClear(wakeupRow(mWakeup1, keyTag(mTs1Key[i])), i);
+	}
+	if (!bitvecIsSet(mTs2Ready, i)) {
+	  ASSERT(bitvecIsSet(wakeupRow(mWakeup2, keyTag(mTs2Key[i])), i));
+	  bitvecClear(wakeupRow(mWakeup2, keyTag(mTs2Key[i])), i);
+	}
       }
-    } 
+    }
+    mValid[w]&=~squashed;
+    mInUse-=__builtin_popcountll(squashed);
+    readyUpdate(w);
   }
 }
 
-void InstQ::a6ClearMask(SpeculateMask mask, Cookie cookie) {
+template<class UArch>
+void InstQ<UArch>::a6ClearMask(SpeculateMask mask COOKIE_PARAM(cookie)) {
   USAGEWARN(simTock, "action before TOCK");
   USAGEWARN(((dNumClear++)<MAX_INSTQ_CLEAR), "exceeding number of InstQ clear port CAM-clear limit\n");
 
   ASSERT(maskIsSetOnceSpeculation(mask));
-	 
-  FOR_INSTQ_SIZE_i {
-    FOR_SPECULATE_DEPTH_j {
-      if (mArray[i].op.dependOn.bit[j] && mask.bit[j]) {
-	if (mArray[i].valid) {
- 	  ASSERT(mArray[i].cookie.serial>cookie.serial);
-	}
-	mArray[i].op.dependOn.bit[j]=false;
-      }
-    } 
+
+#if (DEBUG_LEVEL>=DEBUG_SILENT)
+  camMatchAny(mDependOn, INSTQ_SLOT_WORDS*INSTQ_SLOT_WORD_BITS, mask.bits, mMatch1);
+  for(ULONG w=0; w<INSTQ_SLOT_WORDS; w++) {
+    for(ULONGLONG bits=mMatch1[w]&mValid[w]; bits; bits&=(bits-1)) {
+      ULONG i=w*INSTQ_SLOT_WORD_BITS+__builtin_ctzll(bits);
+      ASSERT(mCookie[i].serial>cookie.serial);
+    }
+  }
+#endif
+
+  for(ULONG i=0; i<INSTQ_SLOT_WORDS*INSTQ_SLOT_WORD_BITS; i++) {
+    mDependOn[i]&=~mask.bits;
   }
 }
 
-#if (UARCH_ROB_RENAME) 
-void InstQ::a7retireTag(RenameTag ptag, RenameTag ltag, Cookie cookie) {
+template<class UArch>
+void InstQ<UArch>::a7retireTag(RenameTag ptag, RenameTag ltag COOKIE_PARAM(cookie)) {
 
   USAGEWARN(simTock, "action before TOCK");
+  ASSERT(UARCH_ROB_RENAME);
   USAGEWARN(((dNumRetire++)<MAX_INSTQ_RETIRE), "exceeding number of InstQ retire CAM-write  port limit\n");
 
   if (!tagEqual(ptag, ZeroRegTag)) {
-    FOR_INSTQ_SIZE_i {
-      if (tagEqual(mArray[i].op.ts1,ptag)) {
-	if (mArray[i].valid) {
-	  ASSERT(mArray[i].cookie.serial>cookie.serial);
-	}
-	mArray[i].op.ts1=ltag;
+    camMatchEqual(mTs1Key, INSTQ_SLOT_WORDS*INSTQ_SLOT_WORD_BITS, tagKey(ptag), mMatch1);
+    camMatchEqual(mTs2Key, INSTQ_SLOT_WORDS*INSTQ_SLOT_WORD_BITS, tagKey(ptag), mMatch2);
+
+    for(ULONG w=0; w<INSTQ_SLOT_WORDS; w++) {
+#if (DEBUG_LEVEL>=DEBUG_SILENT)
+      for(ULONGLONG bits=(mMatch1[w]|mMatch2[w])&mValid[w]; bits; bits&=(bits-1)) {
+	ULONG i=w*INSTQ_SLOT_WORD_BITS+__builtin_ctzll(bits);
+	ASSERT(mCookie[i].serial>cookie.serial);
       }
-      if (tagEqual(mArray[i].op.ts2,ptag)) {
-	if (mArray[i].valid) {
-	  ASSERT(mArray[i].cookie.serial>cookie.serial);
-	}
-	mArray[i].op.ts2=ltag;
+#endif
+      // else stranded on ptag's wakeup row
+      ASSERT((mMatch1[w]&mValid[w]&~mTs1Ready[w])==0);
+      ASSERT((mMatch2[w]&mValid[w]&~mTs2Ready[w])==0);
+
+      for(ULONGLONG bits=mMatch1[w]; bits; bits&=(bits-1)) {
+	mTs1Key[w*INSTQ_SLOT_WORD_BITS+__builtin_ctzll(bits)]=tagKey(ltag);
       }
-    } 
+      for(ULONGLONG bits=mMatch2[w]; bits; bits&=(bits-1)) {
+	mTs2Key[w*INSTQ_SLOT_WORD_BITS+__builtin_ctzll(bits)]=tagKey(ltag);
+      }
+    }
   }
 }
-#endif
 
-void InstQ::printState() {
+////////////////////////////////////////////////////////
+//
+// entries
+//
+////////////////////////////////////////////////////////
+
+template<class UArch>
+Operation InstQ<UArch>::entryOp(ULONG slot) {
+  Operation op=mOp[slot];
+
+  op.ts1=keyTag(mTs1Key[slot]);
+  op.ts2=keyTag(mTs2Key[slot]);
+  op.dependOn.bits=mDependOn[slot];
+
+  return op;
+}
+
+template<class UArch>
+InstQEntry InstQ<UArch>::entry(ULONG slot) {
+  InstQEntry entry;
+
+  entry.slotIdx=slot;
+  entry.valid=bitvecIsSet(mValid, slot);
+  entry.atag=mAtag[slot];
+  entry.op=entryOp(slot);
+  entry.ts1Ready=bitvecIsSet(mTs1Ready, slot);
+  entry.ts2Ready=bitvecIsSet(mTs2Ready, slot);
+  entry.cookie=mCookie[slot];
+
+  return entry;
+}
+
+////////////////////////////////////////////////////////
+//
+// ready bitmap and select
+//
+////////////////////////////////////////////////////////
+
+template<class UArch>
+void InstQ<UArch>::readyUpdate(ULONG word) {
+  mReady[word]=mValid[word]&mTs1Ready[word]&mTs2Ready[word];
+}
+
+//
+// Find the first set bit of vec, visiting slots in the order start,
+// start+1, ... wrapping around at UARCH_INSTQ_SIZE.  The word holding
+// start is visited twice: first its bits at or above start, and
+// last, after wrapping, its bits below start.
+//
+template<class UArch>
+bool InstQ<UArch>::slotPick(const ULONGLONG *vec, ULONG start, ULONG *O_Slot) {
+  ULONG first=start/INSTQ_SLOT_WORD_BITS;
+  ULONGLONG above=(~(ULONGLONG)0)<<(start%INSTQ_SLOT_WORD_BITS);
+
+  ASSERT(start<UARCH_INSTQ_SIZE);
+
+  for(ULONG k=0; k<=INSTQ_SLOT_WORDS; k++) {
+    ULONG w=(first+k)%INSTQ_SLOT_WORDS;
+    ULONGLONG bits=vec[w];
+
+    if (k==0) {
+      bits&=above;
+    } else if (k==INSTQ_SLOT_WORDS) {
+      bits&=~above;
+    }
+    if (bits) {
+      *O_Slot=w*INSTQ_SLOT_WORD_BITS+__builtin_ctzll(bits);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+////////////////////////////////////////////////////////
+//
+// wakeup matrix
+//
+////////////////////////////////////////////////////////
+
+template<class UArch>
+ULONGLONG *InstQ<UArch>::wakeupRow(ULONGLONG *matrix, RenameTag tag) {
+  return matrix+tagToPRegIdx(tag)*INSTQ_SLOT_WORDS;
+}
+
+template<class UArch>
+void InstQ<UArch>::printState() {
 #if (DEBUG_LEVEL>=DEBUG_VERBOSE)
   {
     bool printing=false;
@@ -217,17 +377,16 @@ void InstQ::printState() {
 	  cout << "------------------------------------------------------------------------------------\n";
 	  printing=true;
 	}
-	if (mArray[i].valid) {
-	  if ((mArray[i].ts1Ready) &&
-	      (mArray[i].ts2Ready)) {
-	    prettyPrint(":InINSTQ:", mArray[i].op, mArray[i].cookie, "\t\t", " Readied");
-	  } else if ((mArray[i].ts1Ready) ||
-		     (mArray[i].ts2Ready)) {
-	    prettyPrint(":InINSTQ:", mArray[i].op, mArray[i].cookie, "\t\t", mArray[i].ts1Ready?" 10":" 01");
+	if (bitvecIsSet(mValid, i)) {
+	  bool ts1Ready=bitvecIsSet(mTs1Ready, i);
+	  bool ts2Ready=bitvecIsSet(mTs2Ready, i);
+	  if (ts1Ready && ts2Ready) {
+	    prettyPrint(":InINSTQ:", entryOp(i), mCookie[i], "\t\t", " Readied");
+	  } else if (ts1Ready || ts2Ready) {
+	    prettyPrint(":InINSTQ:", entryOp(i), mCookie[i], "\t\t", ts1Ready?" 10":" 01");
 	  } else {
-	    prettyPrint(":InINSTQ:", mArray[i].op, mArray[i].cookie, "\t\t", "");
+	    prettyPrint(":InINSTQ:", entryOp(i), mCookie[i], "\t\t", "");
 	  }
-	  //cout << "\t\t\t\t" << mArray[i].vs1 << "::" << mArray[i].vs2 << "\n";
 	}
       }
     }
@@ -238,25 +397,55 @@ void InstQ::printState() {
 #endif
 }
 
-void InstQ::rReset() { 
+template<class UArch>
+void InstQ<UArch>::rReset() { 
   simTick();
 
   mInUse=0;
   mScan=0;
-  //mNoBody.slotNum=0;
-  //mNoBody.valid=false;
-  //mNoBody.op.td=0;
-  //mNoBody.op.ts1=0;
-  //mNoBody.op.ts2=0;
-
-  FOR_INSTQ_SIZE_i  {
-    mArray[i].slotIdx=i;
-    mArray[i].valid=0;
+  mRng.rSeed(INSTQ_MSCAN_SEED);
+
+  for(ULONG i=0; i<INSTQ_SLOT_WORDS; i++) {
+    mValid[i]=0;
+    mTs1Ready[i]=0;
+    mTs2Ready[i]=0;
+    mReady[i]=0;
+  }
+  for(ULONG i=0; i<INSTQ_SLOT_WORDS*INSTQ_SLOT_WORD_BITS; i++) {
+    mTs1Key[i]=INSTQ_NO_KEY;
+    mTs2Key[i]=INSTQ_NO_KEY;
+    mDependOn[i]=0;
+  }
+  for(ULONG i=0; i<UARCH_NUM_PHYSICAL_REG*INSTQ_SLOT_WORDS; i++) {
+    mWakeup1[i]=0;
+    mWakeup2[i]=0;
   }
 
   return; 
 }                      
-void InstQ::simTick() { 
+template<class UArch>
+void InstQ<UArch>::rSnapshot(Snapshot *snap) { 
+  SNAP(snap, mInUse);
+  SNAP(snap, mScan);
+  mRng.rSnapshot(snap);
+  SNAP_ARRAY(snap, mValid, INSTQ_SLOT_WORDS);
+  SNAP_ARRAY(snap, mTs1Ready, INSTQ_SLOT_WORDS);
+  SNAP_ARRAY(snap, mTs2Ready, INSTQ_SLOT_WORDS);
+  SNAP_ARRAY(snap, mReady, INSTQ_SLOT_WORDS);
+  SNAP_ARRAY(snap, mTs1Key, INSTQ_SLOT_WORDS*INSTQ_SLOT_WORD_BITS);
+  SNAP_ARRAY(snap, mTs2Key, INSTQ_SLOT_WORDS*INSTQ_SLOT_WORD_BITS);
+  SNAP_ARRAY(snap, mDependOn, INSTQ_SLOT_WORDS*INSTQ_SLOT_WORD_BITS);
+  SNAP_ARRAY(snap, mAtag, UARCH_INSTQ_SIZE);
+  SNAP_ARRAY(snap, mOp, UARCH_INSTQ_SIZE);
+  SNAP_ARRAY(snap, mCookie, UARCH_INSTQ_SIZE);
+  // mMatch1 and mMatch2 are scratch
+  SNAP_ARRAY(snap, mWakeup1, UARCH_NUM_PHYSICAL_REG*INSTQ_SLOT_WORDS);
+  SNAP_ARRAY(snap, mWakeup2, UARCH_NUM_PHYSICAL_REG*INSTQ_SLOT_WORDS);
+}
+
+template<class UArch>
+void InstQ<UArch>::simTick() { 
+#if (DEBUG_LEVEL>=DEBUG_SILENT)
   dNumReadied=0;
   dNumInsert=0;
   dNumIssue=0;
@@ -264,6 +453,7 @@ void InstQ::simTick() {
   dNumRetire=0;
   dNumSquash=0;
   dNumClear=0;
+#endif
 
   return; 
 }                      
@@ -273,7 +463,23 @@ void InstQ::simTick() {
 // Constructors
 //
 ////////////////////////////////////////////////////////
-InstQ::InstQ() {
+template<class UArch>
+InstQ<UArch>::InstQ() {
+  mValid=new ULONGLONG[INSTQ_SLOT_WORDS];
+  mTs1Ready=new ULONGLONG[INSTQ_SLOT_WORDS];
+  mTs2Ready=new ULONGLONG[INSTQ_SLOT_WORDS];
+  mReady=new ULONGLONG[INSTQ_SLOT_WORDS];
+  mTs1Key=new UINT[INSTQ_SLOT_WORDS*INSTQ_SLOT_WORD_BITS];
+  mTs2Key=new UINT[INSTQ_SLOT_WORDS*INSTQ_SLOT_WORD_BITS];
+  mDependOn=new ULONGLONG[INSTQ_SLOT_WORDS*INSTQ_SLOT_WORD_BITS];
+  mAtag=new ULONG[UARCH_INSTQ_SIZE];
+  mOp=new Operation[UARCH_INSTQ_SIZE];
+  mCookie=new Cookie[UARCH_INSTQ_SIZE];
+  mMatch1=new ULONGLONG[INSTQ_SLOT_WORDS];
+  mMatch2=new ULONGLONG[INSTQ_SLOT_WORDS];
+  mWakeup1=new ULONGLONG[UARCH_NUM_PHYSICAL_REG*INSTQ_SLOT_WORDS];
+  mWakeup2=new ULONGLONG[UARCH_NUM_PHYSICAL_REG*INSTQ_SLOT_WORDS];
+
   cout << "MAX_INSTQ_READY=" << MAX_INSTQ_READY << "\n";
   cout << "MAX_INSTQ_INSERT=" << MAX_INSTQ_INSERT << "\n";
   cout << "MAX_INSTQ_ISSUE=" << MAX_INSTQ_ISSUE << "\n";
@@ -287,5 +493,23 @@ InstQ::InstQ() {
   rReset();
 }
 
+template<class UArch>
+InstQ<UArch>::~InstQ() {
+  delete[] mValid;
+  delete[] mTs1Ready;
+  delete[] mTs2Ready;
+  delete[] mReady;
+  delete[] mTs1Key;
+  delete[] mTs2Key;
+  delete[] mDependOn;
+  delete[] mAtag;
+  delete[] mOp;
+  delete[] mCookie;
+  delete[] mMatch1;
+  delete[] mMatch2;
+  delete[] mWakeup1;
+  delete[] mWakeup2;
+}
 
-
+#define INSTANTIATE_INSTQ(U) template class InstQ<U>;
+UARCH_FOR_EACH(INSTANTIATE_INSTQ)
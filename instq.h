@@ -26,7 +26,9 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "sim.h"
 #include "arch.h"
 #include "uarch.h"
+#include "snapshot.h"
 #include "magic.h"
+#include "rng.h"
 
 #define MAX_INSTQ_READY (1)
 #define MAX_INSTQ_INSERT (UARCH_DECODE_WIDTH)
@@ -38,7 +40,36 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #define INSTQ_MSCAN_RANDOM (0)
 #define INSTQ_MSCAN_RROBIN (1)
-#define MSCANSTART (((mScan*INSTQ_MSCAN_RROBIN)+(INSTQ_MSCAN_RANDOM?rand():0))%UARCH_INSTQ_SIZE)
+#define INSTQ_MSCAN_SEED (1)  // of mRng, for INSTQ_MSCAN_RANDOM
+#define MSCANSTART (((mScan*INSTQ_MSCAN_RROBIN)+(INSTQ_MSCAN_RANDOM?mRng.getNext():0))%UARCH_INSTQ_SIZE)
+
+//
+// Wakeup: with INSTQ_WAKEUP_MATRIX, each physical register keeps a
+// bitvector of the slots waiting on it (one for ts1, one for ts2),
+// filled in by a3Insert.  a4Release then visits only the waiting
+// slots instead of comparing the tag against every entry.
+//
+#define INSTQ_WAKEUP_MATRIX (1)
+
+//
+// Bitvectors over the InstQ slots; see sim.h
+//
+#define INSTQ_SLOT_WORD_BITS (BITVEC_WORD_BITS)
+#define INSTQ_SLOT_WORDS (BITVEC_WORDS(UARCH_INSTQ_SIZE))
+
+//
+// RenameTag packed into a CAM key; see cam.h
+//
+#define INSTQ_NO_KEY (~((UINT)0))  // matches no tag; pads the key arrays
+
+static inline UINT tagKey(RenameTag tag) {
+  return (UINT)((tag.idx<<1)|(tag.mapped?1:0));
+}
+
+static inline RenameTag keyTag(UINT key) {
+  RenameTag tag={.mapped=((key&1)!=0), .idx=(key>>1)};
+  return tag;
+}
 
 typedef struct {
   ULONG slotIdx;
@@ -51,6 +82,12 @@ typedef struct {
 
 static const InstQEntry invalidEntryInstQ={.slotIdx=0, .valid=false}; // empty stub value
 
+//
+// Internally, InstQ keeps its entries as parallel arrays so that each
+// CAM search or scan touches only the fields it needs; InstQEntry is
+// assembled only when an entry leaves through q4Readied.
+//
+template<class UArch>
 class InstQ {
  public:
   //
@@ -61,32 +98,54 @@ class InstQ {
   InstQEntry q4Readied(); 
 
   void a3Insert(ULONG ptag, Operation op, 
-		bool ts1Busy, bool ts2Busy, 
-		Cookie cookie);
+		bool ts1Busy, bool ts2Busy
+		COOKIE_PARAM(cookie));
 
 
   void a4Issue(ULONG which);
-  void a4Release(RenameTag tag, Cookie cookie);
+  void a4Release(RenameTag tag COOKIE_PARAM(cookie));
 
-  void a6Squash(SpeculateMask mask, Cookie cookie);
-  void a6ClearMask(SpeculateMask mask, Cookie cookie);
+  void a6Squash(SpeculateMask mask COOKIE_PARAM(cookie));
+  void a6ClearMask(SpeculateMask mask COOKIE_PARAM(cookie));
 
-#if (UARCH_ROB_RENAME)
-  void a7retireTag(RenameTag ptag, RenameTag ltag, Cookie cookie);
-#endif
+  void a7retireTag(RenameTag ptag, RenameTag ltag COOKIE_PARAM(cookie)); // UARCH_ROB_RENAME only
   
   void rReset();
+  void rSnapshot(Snapshot *snap);  // save or restore all state
   void simTick();
 
   // Constructor
   InstQ();
+  ~InstQ();
 
  private:
   ULONG mInUse;
   ULONG mScan;
-  //InstQEntry mNoBody;
-  InstQEntry mArray[UARCH_INSTQ_SIZE];  // change to dyanmic allocate for instq of different depth
-
+  Rng mRng;     // for INSTQ_MSCAN_RANDOM
+
+  // bitvectors by slot, INSTQ_SLOT_WORDS
+  ULONGLONG *mValid;
+  ULONGLONG *mTs1Ready;
+  ULONGLONG *mTs2Ready;
+  ULONGLONG *mReady;   // mValid & mTs1Ready & mTs2Ready
+
+  // by slot, INSTQ_SLOT_WORDS*INSTQ_SLOT_WORD_BITS entries; the
+  // padding never matches in the CAM kernels
+  UINT *mTs1Key;       // tagKey(op.ts1)
+  UINT *mTs2Key;       // tagKey(op.ts2)
+  ULONGLONG *mDependOn; // op.dependOn.bits
+
+  // by slot, UARCH_INSTQ_SIZE entries
+  ULONG *mAtag;
+  Operation *mOp;      // payload; ts1, ts2 and dependOn are kept above
+  Cookie *mCookie;
+
+  ULONGLONG *mMatch1;  // CAM results, INSTQ_SLOT_WORDS
+  ULONGLONG *mMatch2;
+  ULONGLONG *mWakeup1; // UARCH_NUM_PHYSICAL_REG rows of
+  ULONGLONG *mWakeup2; // INSTQ_SLOT_WORDS; see INSTQ_WAKEUP_MATRIX
+
+#if (DEBUG_LEVEL>=DEBUG_SILENT)
   ULONG dNumReadied;
   ULONG dNumInsert;
   ULONG dNumIssue;
@@ -94,6 +153,14 @@ class InstQ {
   ULONG dNumRetire;
   ULONG dNumSquash;
   ULONG dNumClear;
+#endif
+
+  InstQEntry entry(ULONG slot);
+  Operation entryOp(ULONG slot);
+
+  ULONGLONG *wakeupRow(ULONGLONG *matrix, RenameTag tag);
+  void readyUpdate(ULONG word);
+  bool slotPick(const ULONGLONG *vec, ULONG start, ULONG *O_Slot);
 
   void printState();
 };
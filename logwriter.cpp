@@ -0,0 +1,217 @@
+#define LOGWRITER_CPP
+/*********************************************************************
+Copyright 2019 James C. Hoe
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+
+#include <cstring>
+#include <chrono>
+
+#include "sim.h"
+
+#include "logwriter.h"
+
+bool LogWriter::qOpen() {
+  return (mWriter!=NULL);
+}
+
+bool LogWriter::aOpen(FILE *file) {
+  aClose();
+
+  if (!mBlock[0]) {
+    mBlock[0]=new char[LOGWRITER_BLOCK_BYTES];
+    mBlock[1]=new char[LOGWRITER_BLOCK_BYTES];
+  }
+  mFile=file;
+  mCurrent=0;
+  mFill=0;
+  mFull[0].store(0);
+  mFull[1].store(0);
+  mStop.store(false);
+  mGood.store(true);
+
+  mWriter=new std::thread(&LogWriter::write, this);
+  return true;
+}
+
+// give the current block to the writer and take the other one
+void LogWriter::handOff() {
+  if (!mFill) {
+    return;
+  }
+  mFull[mCurrent].store(mFill, std::memory_order_release);
+  mCurrent^=1;
+  mFill=0;
+  while(mFull[mCurrent].load(std::memory_order_acquire)) {
+    std::this_thread::yield();
+  }
+}
+
+void *LogWriter::aReserve(ULONG bytes) {
+  void *room;
+
+  assert(mWriter&&(bytes<=LOGWRITER_BLOCK_BYTES));
+
+  if ((mFill+bytes)>LOGWRITER_BLOCK_BYTES) {
+    handOff();
+  }
+  room=mBlock[mCurrent]+mFill;
+  mFill+=bytes;
+  return room;
+}
+
+void LogWriter::aWrite(const void *data, ULONG bytes) {
+  const char *from=(const char*)data;
+
+  while(bytes) {
+    ULONG take=MIN(bytes, LOGWRITER_BLOCK_BYTES-mFill);
+
+    if (!take) {
+      handOff();
+      continue;
+    }
+    memcpy(mBlock[mCurrent]+mFill, from, take);
+    mFill+=take;
+    from+=take;
+    bytes-=take;
+  }
+}
+
+void LogWriter::write() {
+  ULONG block=0;
+
+  for(;;) {
+    ULONG bytes=mFull[block].load(std::memory_order_acquire);
+
+    if (bytes) {
+      if (fwrite(mBlock[block], bytes, 1, mFile)!=1) {
+	mGood.store(false);
+      }
+      mFull[block].store(0, std::memory_order_release);
+      block^=1;
+    } else if (mStop.load(std::memory_order_acquire)) {
+      return;
+    } else {
+      std::this_thread::sleep_for(std::chrono::microseconds(LOGWRITER_NAP_US));
+    }
+  }
+}
+
+bool LogWriter::aClose() {
+  if (!mWriter) {
+    return true;
+  }
+  handOff();
+  // both blocks written out; nothing more will come
+  while(mFull[mCurrent^1].load(std::memory_order_acquire)) {
+    std::this_thread::yield();
+  }
+  mStop.store(true, std::memory_order_release);
+  mWriter->join();
+  delete mWriter;
+  mWriter=NULL;
+
+  if (fflush(mFile)) {
+    mGood.store(false);
+  }
+  return mGood.load();
+}
+
+void LogWriter::aSalvage() {
+  if (!mWriter) {
+    return;
+  }
+  // once the writer is done with the other block, mFile is ours
+  while(mFull[mCurrent^1].load(std::memory_order_acquire)) {
+    std::this_thread::yield();
+  }
+  if (mFill) {
+    fwrite(mBlock[mCurrent], mFill, 1, mFile);
+    mFill=0;
+  }
+  fflush(mFile);
+}
+
+bool TextLog::qOpen() {
+  return mWriter.qOpen();
+}
+
+bool TextLog::aOpen(FILE *file) {
+  aClose();
+  return mWriter.aOpen(file);
+}
+
+void TextLog::aCapture(ostream &out) {
+  assert(!mCaptured);
+
+  mCaptured=&out;
+  mCapturedBuf=out.rdbuf(this);
+}
+
+int TextLog::overflow(int c) {
+  if (c!=EOF) {
+    char ch=c;
+    mWriter.aWrite(&ch, 1);
+  }
+  return c;
+}
+
+std::streamsize TextLog::xsputn(const char *s, std::streamsize n) {
+  mWriter.aWrite(s, n);
+  return n;
+}
+
+bool TextLog::aClose() {
+  if (mCaptured) {
+    mCaptured->rdbuf(mCapturedBuf);
+    mCaptured=NULL;
+  }
+  return mWriter.aClose();
+}
+
+void TextLog::aSalvage() {
+  mWriter.aSalvage();
+}
+
+////////////////////////////////////////////////////////
+//
+// Constructors
+//
+////////////////////////////////////////////////////////
+LogWriter::LogWriter() :
+  mFile(NULL), mCurrent(0), mFill(0), mFull{{0}, {0}}, mStop(false), mGood(true), mWriter(NULL) {
+  mBlock[0]=NULL;
+  mBlock[1]=NULL;
+}
+
+LogWriter::~LogWriter() {
+  aClose();
+  delete[] mBlock[0];
+  delete[] mBlock[1];
+}
+
+TextLog::TextLog() : mCaptured(NULL), mCapturedBuf(NULL) {
+}
+
+TextLog::~TextLog() {
+  aClose();
+}
@@ -0,0 +1,107 @@
+#ifndef LOGWRITER_H
+#define LOGWRITER_H
+/*********************************************************************
+Copyright 2019 James C. Hoe
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+
+#include <cstdio>
+#include <atomic>
+#include <thread>
+#include <streambuf>
+
+#include "sim.h"
+
+/*
+ * Log output is written by a thread of its own, so the simulation
+ * does not wait on the disk.  Bytes are collected in one of two
+ * LOGWRITER_BLOCK_BYTES blocks; a full block is handed to the writer
+ * thread while the other one fills.  Nothing is written before a
+ * block is full, except at aClose().  Handing a block over only
+ * waits if the writer is still busy with the previous one.
+ *
+ * aSalvage() is for a process about to die (e.g., on SIGABRT from a
+ * failed assert): it writes out what is buffered from the calling
+ * thread, which must be the one writing the log.
+ */
+
+#define LOGWRITER_BLOCK_BYTES (1<<20)
+#define LOGWRITER_NAP_US (1000)  // writer's wait for a block to fill
+
+class LogWriter {
+ public:
+  bool qOpen();
+
+  bool aOpen(FILE *file);  // not closed by aClose()
+  void *aReserve(ULONG bytes);  // room for bytes, contiguous; valid
+				// until the next aReserve() or aWrite()
+  void aWrite(const void *data, ULONG bytes);
+  bool aClose();  // writes out everything; false on a write error
+  void aSalvage();
+
+  // Constructor
+  LogWriter();
+  ~LogWriter();
+
+ private:
+  FILE *mFile;
+  char *mBlock[2];
+  ULONG mCurrent;  // block being filled
+  ULONG mFill;     // bytes in it
+
+  std::atomic<ULONG> mFull[2];  // bytes handed over; 0 once written
+  std::atomic<bool> mStop;
+  std::atomic<bool> mGood;
+  std::thread *mWriter;
+
+  void handOff();
+  void write();  // the writer thread
+};
+
+//
+// Text output through a LogWriter; point cout at it with aCapture()
+//
+class TextLog : public std::streambuf {
+ public:
+  bool qOpen();
+
+  bool aOpen(FILE *file);
+  void aCapture(ostream &out);  // until aClose()
+  bool aClose();
+  void aSalvage();  // see LogWriter
+
+  // Constructor
+  TextLog();
+  ~TextLog();
+
+ protected:
+  int overflow(int c);
+  std::streamsize xsputn(const char *s, std::streamsize n);
+
+ private:
+  LogWriter mWriter;
+
+  ostream *mCaptured;
+  std::streambuf *mCapturedBuf;
+};
+
+#endif
@@ -31,6 +31,11 @@ ULONG Magic::qSerial() {
   return mSerial;
 }
 
+DataValue Magic::qArchReg(LogicalRegName r) {
+  assert(mSpeculating==0);
+  return mRF[r];
+}
+
 Biscuit Magic::aFunctional(Instruction inst) {
   Biscuit biscuit;
 
@@ -40,7 +45,7 @@ Biscuit Magic::aFunctional(Instruction inst) {
     mSpeculating++;
   }
 
-  assert(biscuit.speculating<(UARCH_OOO_DEGREE+UARCH_DECODE_WIDTH));
+  assert(biscuit.speculating<MAGIC_LOG_SIZE);
 
   // overwrite entry 0 if not speculating
   log[biscuit.speculating].serial=biscuit.serial;
@@ -50,6 +55,7 @@ Biscuit Magic::aFunctional(Instruction inst) {
   log[biscuit.speculating].isException=false;
 
   biscuit.inst=inst;
+  biscuit.vdOld=mRF[inst.rd];
   biscuit.vs1=inst.rs1?mRF[inst.rs1]:0;
   biscuit.vs2=inst.rs2?mRF[inst.rs2]:0;
   biscuit.vd=biscuit.vs1+biscuit.vs2;
@@ -94,9 +100,29 @@ Biscuit Magic::aFunctional(Instruction inst) {
   return biscuit;
 };
 
+//
+// Execute an instruction as if the datapath took it and retired it
+// right away: a mispredicted branch has no wrong path to rewind, and
+// an exception instruction is dropped as by its restart, without
+// writing its result.
+//
+void Magic::aFastForward(Instruction inst) {
+  assert(mSpeculating==0);
+
+  if (inst.exception) {
+    mSerial++;
+    return;
+  }
+
+  inst.miss=false;
+  aFunctional(inst);
+
+  assert(mSpeculating==0);
+}
+
 void Magic::aRewind(ULONG serial) {
   assert(mSpeculating);
-  bool found=false;
+  [[maybe_unused]] bool found=false;  // assert() only
 
   while(mSpeculating--) {
     if (serial==log[mSpeculating].serial) {
@@ -125,7 +151,7 @@ void Magic::aRewind(ULONG serial) {
 
 
 void Magic::aRestart(ULONG serial) {
-  bool found=false;
+  [[maybe_unused]] bool found=false;  // assert() only
   assert(mSpeculating);
 
   while(mSpeculating--) {
@@ -147,6 +173,22 @@ void Magic::aRestart(ULONG serial) {
   return;
 }
 
+//
+// Return to the state just before the aFunctional() that made
+// biscuit, which must be the latest one not yet taken back.  The log
+// entries of older instructions are still intact, since no rewind or
+// restart came in between.
+//
+void Magic::aUndo(Biscuit biscuit) {
+  assert(biscuit.serial==(mSerial-1));
+
+  mSerial=biscuit.serial;
+  mSpeculating=biscuit.speculating;
+  if (biscuit.inst.rd!=R0) {
+    mRF[biscuit.inst.rd]=biscuit.vdOld;
+  }
+}
+
 void Magic::rReset() {
   mSerial=0; 
   mSpeculating=0;
@@ -156,12 +198,31 @@ void Magic::rReset() {
   }
 }
 
+void Magic::rSnapshot(Snapshot *snap) {
+  SNAP(snap, mSerial);
+  SNAP(snap, mSpeculating);
+  SNAP(snap, mRF);
+
+  // only the first mSpeculating entries of the log are live
+  if (mSpeculating>=MAGIC_LOG_SIZE) {
+    snap->aFail("corrupt replay log");
+    return;
+  }
+  SNAP_ARRAY(snap, log, mSpeculating);
+}
+
 ////////////////////////////////////////////////////////
 //
 // Constructors
 //
 ////////////////////////////////////////////////////////
 Magic::Magic() {
+  log=new ReplayLog[MAGIC_LOG_SIZE];
+
   rReset();
 }
 
+Magic::~Magic() {
+  delete[] log;
+}
+
@@ -26,6 +26,15 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "sim.h"
 #include "arch.h"
 #include "uarch.h"
+#include "snapshot.h"
+
+//
+// Magic may run up to MAGIC_RUNAHEAD instructions ahead of those
+// offered to the datapath (see fetch.h), so its replay log covers
+// them on top of everything the datapath can hold
+//
+#define MAGIC_RUNAHEAD (256)
+#define MAGIC_LOG_SIZE (UARCH_OOO_DEGREE+UARCH_DECODE_WIDTH+MAGIC_RUNAHEAD)
 
 typedef struct{
 #if (DEBUG_LEVEL>=DEBUG_SILENT)
@@ -37,12 +46,27 @@ typedef struct{
 #endif
 } Cookie;
 
+//
+// A Cookie only carries anything when asserts are on.  Below
+// DEBUG_SILENT, datapath interfaces drop their Cookie parameters
+// altogether: declare them with COOKIE_PARAM(name) and pass them with
+// COOKIE_ARG(value), after the last regular argument.
+//
+#if (DEBUG_LEVEL>=DEBUG_SILENT)
+#define COOKIE_PARAM(c) , Cookie c
+#define COOKIE_ARG(c) , c
+#else
+#define COOKIE_PARAM(c)
+#define COOKIE_ARG(c)
+#endif
+
 typedef struct{
   ULONG serial;
   DataValue vd, vs1, vs2;
   Instruction inst;
   Operation op;
   ULONG speculating;
+  DataValue vdOld;  // RF[rd] before this instruction; see Magic::aUndo()
 } Biscuit;
 
 
@@ -58,23 +82,28 @@ class Magic {
  public:
 
   ULONG qSerial();
+  DataValue qArchReg(LogicalRegName r);  // architectural value; not speculating
 
   Biscuit aFunctional(Instruction inst);
+  void aFastForward(Instruction inst);   // commit without a datapath
   void aRewind(ULONG serial);
   void aRestart(ULONG serial);
+  void aUndo(Biscuit biscuit);           // take back the last aFunctional()
 
   void rReset();
+  void rSnapshot(Snapshot *snap);  // save or restore all state
 
   void simTick();
 
   // Constructor
   Magic();
+  ~Magic();
 
  private:
   ULONG mSerial;
   ULONG mSpeculating;
 
-  ReplayLog log[UARCH_OOO_DEGREE+UARCH_DECODE_WIDTH];
+  ReplayLog *log;  // MAGIC_LOG_SIZE entries
   DataValue mRF[ARCH_NUM_LOGICAL_REG];
 };
 
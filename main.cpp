@@ -22,63 +22,158 @@ OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
 WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 *********************************************************************/
 
+#include <cstring>
+#include <csignal>
+
 #include "sim.h"
 #include "arch.h"
 #include "uarch.h"
 
-#include "datapath.h"
+#include "config.h"
+#include "core.h"
+#include "print.h"
+#include "eventlog.h"
+#include "logwriter.h"
 
-FetchBundle nothing={.howmany=0};
+// static, so what is buffered still goes out on exit()
+static EventLog eventLog;
+static TextLog textLog;
 
-int main(int argc, char *argv[]) {
-  ULONG countdown=UARCH_OOO_DEGREE*2;
-  ULONG cycle=0;
-  ULONG instCount=0;
+// a failed assert aborts; write out what the logs still hold first
+static void salvage(int sig) {
+  eventLog.aSalvage();
+  textLog.aSalvage();
+}
+
+static void usage(const char *prog) {
+  cerr << "usage: " << prog << " [-c config-file] [--option VALUE ...] [NAME=VALUE ...]\n";
+  cerr << "  --option is --fast-forward, --sample-period, --sample-warmup, --sample-window,\n";
+  cerr << "  --save, --save-at, --restore, --trace, --record, --replay or --producer\n";
+  cerr << "  (see config.h)\n";
+  cerr << "  with --write-trace FILE, the configured trace is written out as a binary trace,\n";
+  cerr << "  block-compressed if --compress is also given\n";
+  cerr << "  with --event-log FILE, all output goes to FILE as a binary event log instead;\n";
+  cerr << "  ooo-decode FILE prints it\n";
+  cerr << "  with --async-output, output is written by a thread of its own\n";
+  cerr << "  NAME is any UARCH_* or TRACE_* parameter printed at startup, or TRACE_SEED\n";
+}
 
+int main(int argc, char *argv[]) {
   //----------------------------------------------------
   //
-  // instantiate datapath objects
+  // load runtime configuration; later settings override earlier
   // 
   //----------------------------------------------------
-  Fetch fetch;
-
-  FetchBundle fetchedInsts;
-  ULONG accept;
-  bool rewind;
-  bool restart;
-  ULONG gotoPC;
-
-  fetch.rReset();
-  datapath(true, nothing, &accept, &rewind, &restart, &gotoPC );
-
-  while(1) {
-    fetchedInsts=fetch.qGetInsts();
-
-    datapath(false, fetchedInsts, &accept, &rewind, &restart, &gotoPC );
-    instCount+=accept;
-    
-    fetch.aAccept(accept);
-    if (rewind) {
-      ASSERT(!restart);
-      fetch.aRewind(gotoPC);
-    }
-    if (restart) {
-      ASSERT(!rewind);
-      fetch.aRestart(gotoPC);
+  SimConfig config;
+  const char *writeTrace=NULL;
+  bool compress=false;
+  const char *eventLogFile=NULL;
+  bool asyncOutput=false;
+
+  configDefault(&config);
+  for(int i=1; i<argc; i++) {
+    if (!strcmp(argv[i], "-c")) {
+      if ((++i)==argc) {
+	usage(argv[0]);
+	return 1;
+      }
+      if (!configLoad(&config, argv[i])) {
+	return 1;
+      }
+    } else if (configIsOption(argv[i])) {
+      if ((++i)==argc) {
+	usage(argv[0]);
+	return 1;
+      }
+      if (!configOption(&config, argv[i-1], argv[i])) {
+	return 1;
+      }
+    } else if (!strcmp(argv[i], "--write-trace")) {
+      if ((++i)==argc) {
+	usage(argv[0]);
+	return 1;
+      }
+      writeTrace=argv[i];
+    } else if (!strcmp(argv[i], "--compress")) {
+      compress=true;
+    } else if (!strcmp(argv[i], "--event-log")) {
+      if ((++i)==argc) {
+	usage(argv[0]);
+	return 1;
+      }
+      eventLogFile=argv[i];
+    } else if (!strcmp(argv[i], "--async-output")) {
+      asyncOutput=true;
+    } else if ((!strcmp(argv[i], "-h"))||(!strcmp(argv[i], "--help"))) {
+      usage(argv[0]);
+      return 0;
+    } else if (!configAssign(&config, argv[i])) {
+      usage(argv[0]);
+      return 1;
     }
+  }
+  if (!configCheck(&config)) {
+    return 1;
+  }
 
-    if (fetchedInsts.howmany==0) {
-      if ((--countdown)==0) {
-	break;
-      }
+  if (writeTrace) {
+    // convert the configured trace instead of simulating
+    return traceWrite(&config.trace, writeTrace, compress)?0:1;
+  }
+
+  if (eventLogFile) {
+    if (!eventLog.aOpen(eventLogFile)) {
+      return 1;
     }
+    eventLog.aCapture(cout);
+    printLog=&eventLog;
+  } else if (asyncOutput) {
+    if (!strcmp(config.recordFile, "-")) {
+      cerr << "--async-output does not go with a recording on stdout\n";
+      return 1;
+    }
+    // printouts are written behind the simulation
+    textLog.aOpen(stdout);
+    textLog.aCapture(cout);
+  }
+  if (eventLogFile||asyncOutput) {
+    signal(SIGABRT, salvage);
+  }
 
-    // advance time
-    simTimer+=TICK_CYC;
-    cycle++;
+  //----------------------------------------------------
+  //
+  // instantiate and run a core
+  // 
+  //----------------------------------------------------
+  CoreStats stats=coreRun(&config);
+
+  if (stats.fastForward) {
+    cout << "Fast-forwarded: " << stats.fastForward << " instructions.\n";
+  }
+  if (stats.windows) {
+    double ipc, low, high;
+
+    cout << "Sampled: " << stats.windows << " windows; IPC ";
+    if (coreEstimateIPC(&stats, &ipc, &low, &high)) {
+      cout << ipc << " in [" << low << ", " << high << "] at " 
+	   << CORE_SAMPLE_CONFIDENCE << " confidence (+" << (100.0*(high-ipc)/ipc) 
+	   << "%/-" << (100.0*(ipc-low)/ipc) << "%)";
+    } else {
+      cout << ipc;
+    }
+    cout << ".\n";
   }
+  cout << "Exiting: " << stats.cycles << " cycles; " << stats.insts << " instructions completed.\n";
 
-  cout << "Exiting: " << cycle << " cycles; " << instCount << " instructions completed.\n";
+  if (eventLogFile) {
+    printLog=NULL;
+    if (!eventLog.aClose()) {
+      return 1;
+    }
+  }
+  if (!textLog.aClose()) {
+    return 1;
+  }
 
-  return 0;
+  return stats.failed?1:0;
 }
@@ -30,15 +30,11 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "print.h"
 
 #include "checkpoint.h"
+#include "eventlog.h"
 
-void printMask(SpeculateMask mask) {
-  cout << " ";
-  FOR_SPECULATE_DEPTH_i {
-    cout << (mask.bit[i]?"1":"0");
-  }
-}
-
+EventLog *printLog=NULL;
 
+#if (DEBUG_LEVEL>=DEBUG_FULL)
 Operation NULLOP;
 
 void prettyPrint(const char stage[], Cookie cookie) {
@@ -50,31 +46,43 @@ void prettyPrint(const char stage[], Operation op, Cookie cookie) {
 }
 
 void prettyPrint(const char stage[], Operation op, Cookie cookie, const char prefix[], const char suffix[]) {
-#if (DEBUG_LEVEL>=DEBUG_FULL) 
+  EventRecord rec;
+  EventPipe *pipe=&rec.u.pipe;
 
   if ((simTimer/TICK_CYC)%DEBUG_PRINT_DOWNSAMPLE) { return; }
 
-  cout << prefix ;
-  cout << "cyc" << (simTimer/TICK_CYC) << stage << "s" << cookie.serial << "(" << (cookie.speculating) << ")";
-  cout << OpCodeString[cookie.inst.opcode];
-  if (cookie.inst.opcode==BEQ) {
-    cout << "(";
-    if (cookie.inst.miss) {
-      cout << "m";
+  rec.kind=EVENT_PIPE;
+  rec.length=0;
+  rec.flags=(cookie.inst.miss?EVENTLOG_MISS:0)|(cookie.inst.exception?EVENTLOG_EXCEPTION:0);
+  rec.depth=UARCH_SPECULATE_DEPTH;
+  rec.reserved=0;
+  pipe->cycle=simTimer/TICK_CYC;
+  pipe->serial=cookie.serial;
+  pipe->speculating=cookie.speculating;
+  pipe->checkpoint=op.checkpoint;
+  pipe->dependOn=op.dependOn.bits;
+  pipe->td=tagToPRegIdx(op.td);
+  pipe->ts1=tagToPRegIdx(op.ts1);
+  pipe->ts2=tagToPRegIdx(op.ts2);
+  pipe->rd=cookie.inst.rd;
+  pipe->rs1=cookie.inst.rs1;
+  pipe->rs2=cookie.inst.rs2;
+  pipe->opcode=cookie.inst.opcode;
+
+  if (printLog) {
+    LONG s=eventIndex(eventStage, stage);
+    LONG p=eventIndex(eventPrefix, prefix);
+    LONG x=eventIndex(eventSuffix, suffix);
+
+    if ((s>=0)&&(p>=0)&&(x>=0)) {
+      rec.stage=s;
+      rec.prefix=p;
+      rec.suffix=x;
+      printLog->aPipe(&rec);
+      return;
     }
-    cout << op.checkpoint << ")";
-  }
-  if (cookie.inst.exception) {
-    cout << "Ex";
+    // not in the tables; cout goes to the log as text
   }
-  cout << " rd=R" << cookie.inst.rd 
-       << " rs1=R" << cookie.inst.rs1 
-       << " rs2=R" << cookie.inst.rs2  ;
-  cout << " :: td=t" << tagToPRegIdx(op.td) 
-       << " ts1=t" << tagToPRegIdx(op.ts1) 
-       << " ts2=t" << tagToPRegIdx(op.ts2) ;
-  printMask(op.dependOn);
-  cout << suffix ;
-  cout << "\n";
+  eventRender(cout, &rec, stage, prefix, suffix);
+}
 #endif
-}  
@@ -38,10 +38,21 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define EkSTAGE  ":   Ek:"
 #define RSTAGE   ":    R:"
 
+//
+// If set, prettyPrint() appends to this log instead of printing; see
+// eventlog.h
+//
+class EventLog;
+extern EventLog *printLog;
+
+#if (DEBUG_LEVEL>=DEBUG_FULL)
 void prettyPrint(const char stage[], Cookie cookie);
 
 void prettyPrint(const char stage[], Operation op, Cookie cookie);
 
 void prettyPrint(const char stage[], Operation op, Cookie cookie, const char prefix[], const char suffix[]);
+#else
+#define prettyPrint(...)  // prints nothing; arguments are not evaluated
+#endif
 
 #endif
@@ -77,10 +77,29 @@ void RegFile::rReset() {
 
   return; 
 }                      
+// reset, then hold the given architectural values in the physical
+// registers that a reset RMap maps the logical registers to
+void RegFile::rSeed(const DataValue archRF[ARCH_NUM_LOGICAL_REG]) { 
+  rReset();
+
+  ASSERT(archRF[R0]==0);
+
+  for(ULONG i=1; i<ARCH_NUM_LOGICAL_REG; i++)  {
+    mArray[i]=archRF[i];
+  }
+
+  return; 
+}                      
+void RegFile::rSnapshot(Snapshot *snap) { 
+  SNAP_ARRAY(snap, mArray, UARCH_NUM_PHYSICAL_REG);
+}
+
 void RegFile::simTick() { 
 
+#if (DEBUG_LEVEL>=DEBUG_SILENT)
   dNumRead=0;
   dNumWrite=0;
+#endif
 
   return; 
 }                      
@@ -91,9 +110,15 @@ void RegFile::simTick() {
 //
 ////////////////////////////////////////////////////////
 RegFile::RegFile() {
+  mArray=new DataValue[UARCH_NUM_PHYSICAL_REG];
+
   cout << "MAX_REGFILE_READ=" << MAX_REGFILE_READ << "\n";
   cout << "MAX_REGFILE_WRITE=" << MAX_REGFILE_WRITE << "\n";
 
   rReset();
 }
 
+RegFile::~RegFile() {
+  delete[] mArray;
+}
+
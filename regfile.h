@@ -26,14 +26,10 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "sim.h"
 #include "arch.h"
 #include "uarch.h"
+#include "snapshot.h"
 
-#if (UARCH_ROB_RENAME)
-#define MAX_REGFILE_READ (UARCH_DECODE_WIDTH*2+UARCH_RETIRE_WIDTH)
-#define MAX_REGFILE_WRITE (UARCH_EXECUTE_WIDTH+UARCH_RETIRE_WIDTH)
-#else
-#define MAX_REGFILE_READ (UARCH_EXECUTE_WIDTH*2)
-#define MAX_REGFILE_WRITE (UARCH_EXECUTE_WIDTH)
-#endif
+#define MAX_REGFILE_READ (UARCH_ROB_RENAME?(UARCH_DECODE_WIDTH*2+UARCH_RETIRE_WIDTH):(UARCH_EXECUTE_WIDTH*2))
+#define MAX_REGFILE_WRITE (UARCH_ROB_RENAME?(UARCH_EXECUTE_WIDTH+UARCH_RETIRE_WIDTH):(UARCH_EXECUTE_WIDTH))
 
 class RegFile {
  public:
@@ -42,16 +38,21 @@ class RegFile {
   void a6Write(PhysicalRegIdx preg, DataValue val);
 
   void rReset();
+  void rSnapshot(Snapshot *snap);  // save or restore all state
+  void rSeed(const DataValue archRF[ARCH_NUM_LOGICAL_REG]);
 
   void simTick();
 
   // Constructor
   RegFile();
+  ~RegFile();
 
  private:
-  DataValue mArray[UARCH_NUM_PHYSICAL_REG];
+  DataValue *mArray;  // UARCH_NUM_PHYSICAL_REG entries
+#if (DEBUG_LEVEL>=DEBUG_SILENT)
   ULONG dNumRead;
   ULONG dNumWrite;
+#endif
 };
 
 #endif
@@ -36,7 +36,8 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 ////////////////////////////////////////////////////////
 
 // lookup logical to physical mapping
-RenameTag RMap::q2GetMap(LogicalRegName lreg) { 
+template<class UArch>
+RenameTag RMap<UArch>::q2GetMap(LogicalRegName lreg) { 
   USAGEWARN((!simTock), "query after TOCK");
   USAGEWARN(((dNumRead++)<MAX_RMAP_READ), "exceeding number of RMap read port limit\n");
 
@@ -45,13 +46,13 @@ RenameTag RMap::q2GetMap(LogicalRegName lreg) {
   RenameTag tag;
 
   if (lreg!=R0) {
-#if (UARCH_ROB_RENAME)
-    tag.mapped=mArray[lreg].mapped;
-    tag.idx=tag.mapped?mArray[lreg].idx:lreg;
-#else
-    tag=mArray[lreg];
-    ASSERT(tag.idx<UARCH_NUM_PHYSICAL_REG);
-#endif
+    if (UARCH_ROB_RENAME) {
+      tag.mapped=mArray[lreg].mapped;
+      tag.idx=tag.mapped?mArray[lreg].idx:lreg;
+    } else {
+      tag=mArray[lreg];
+      ASSERT(tag.idx<UARCH_NUM_PHYSICAL_REG);
+    }
   } else {
     tag=ZeroRegTag;
   }
@@ -61,7 +62,8 @@ RenameTag RMap::q2GetMap(LogicalRegName lreg) {
 }
 
 // set new logical to physical mapping
-void RMap::a2SetMap(LogicalRegName lreg, RenameTag tag) {
+template<class UArch>
+void RMap<UArch>::a2SetMap(LogicalRegName lreg, RenameTag tag) {
 
   USAGEWARN(simTock, "action before TOCK");
   USAGEWARN(((dNumWrite++)<MAX_RMAP_WRITE), "exceeding number of RMap write port limit\n");
@@ -69,48 +71,100 @@ void RMap::a2SetMap(LogicalRegName lreg, RenameTag tag) {
   ASSERT(lreg<ARCH_NUM_LOGICAL_REG);
 
   if (lreg!=R0) {
-#if (UARCH_ROB_RENAME)
-    ASSERT(tag.mapped);
-    ASSERT(tag.idx<(1*UARCH_OOO_DEGREE));
-#else
-    ASSERT(tag.idx<UARCH_NUM_PHYSICAL_REG);
-#endif
+    if (UARCH_ROB_RENAME) {
+      ASSERT(tag.mapped);
+      ASSERT(tag.idx<(1*UARCH_OOO_DEGREE));
+    } else {
+      ASSERT(tag.idx<UARCH_NUM_PHYSICAL_REG);
+    }
     
+    if (RMAP_DELTA_CHECKPOINT) {
+      // save the old mapping into live checkpoints that have not yet
+      // seen lreg redefined
+      for(ULONGLONG live=mLive.bits; live; live&=(live-1)) {
+	ULONG i=__builtin_ctzll(live);
+	if (!((mDirty[i]>>lreg)&1)) {
+	  mStack[i][lreg]=mArray[lreg];
+	  mDirty[i]|=((ULONGLONG)1)<<lreg;
+	}
+      }
+    }
+
     mArray[lreg]=tag;
   }
 
   return;
 }
 
-void RMap::a2CheckPoint(ULONG which) {
+template<class UArch>
+void RMap<UArch>::a2CheckPoint(ULONG which) {
   USAGEWARN(simTock, "action before TOCK");
   USAGEWARN(((dNumCheckpoint++)<MAX_RMAP_CHECKPOINT), "exceeding number of RMap checkpoint port limit\n");
 
   ASSERT(which<UARCH_SPECULATE_DEPTH);
 
-  for(ULONG i=0; i<ARCH_NUM_LOGICAL_REG; i++) {
-    mStack[which][i]=mArray[i];
+  if (RMAP_DELTA_CHECKPOINT) {
+    ASSERT(!dependOnSpeculation(mLive, which));
+    mDirty[which]=0;
+    mBorn[which]=mClock++;
+    setSpeculation(&mLive, which);
+  } else {
+    for(ULONG i=0; i<ARCH_NUM_LOGICAL_REG; i++) {
+      mStack[which][i]=mArray[i];
+    }
   }
 
   return;
 }
  
-void RMap::a6Rewind(ULONG which) {
+template<class UArch>
+void RMap<UArch>::a6Rewind(ULONG which) {
+  USAGEWARN(simTock, "action before TOCK");
+
+  ASSERT(which<UARCH_SPECULATE_DEPTH);
+
+  if (RMAP_DELTA_CHECKPOINT) {
+    ASSERT(dependOnSpeculation(mLive, which));
+    for(ULONGLONG dirty=mDirty[which]; dirty; dirty&=(dirty-1)) {
+      ULONG i=__builtin_ctzll(dirty);
+      mArray[i]=mStack[which][i];
+    }
+
+    // this and all younger checkpoints are gone
+    for(ULONGLONG live=mLive.bits; live; live&=(live-1)) {
+      ULONG i=__builtin_ctzll(live);
+      if (mBorn[i]>=mBorn[which]) {
+	mLive.bits&=~(((ULONGLONG)1)<<i);
+      }
+    }
+  } else {
+    for(ULONG i=0; i<ARCH_NUM_LOGICAL_REG; i++) {
+      mArray[i]=mStack[which][i];
+    }
+  }
+
+  return;
+}
+
+template<class UArch>
+void RMap<UArch>::a6Free(ULONG which) {
   USAGEWARN(simTock, "action before TOCK");
 
   ASSERT(which<UARCH_SPECULATE_DEPTH);
 
-  for(ULONG i=0; i<ARCH_NUM_LOGICAL_REG; i++) {
-    mArray[i]=mStack[which][i];
+  if (RMAP_DELTA_CHECKPOINT) {
+    ASSERT(dependOnSpeculation(mLive, which));
+    mLive.bits&=~(((ULONGLONG)1)<<which);
   }
 
   return;
 }
 
-#if (UARCH_ROB_RENAME)
-void RMap::a7Unmap(LogicalRegName lreg, RenameTag old) {
+template<class UArch>
+void RMap<UArch>::a7Unmap(LogicalRegName lreg, RenameTag old) {
 
   USAGEWARN(simTock, "action before TOCK");
+  ASSERT(UARCH_ROB_RENAME);
   USAGEWARN(((dNumUnmap++)<MAX_RMAP_UNMAP), "exceeding number of RMap unmap clear port limit\n");
 
   ASSERT(lreg<ARCH_NUM_LOGICAL_REG);
@@ -123,7 +177,17 @@ void RMap::a7Unmap(LogicalRegName lreg, RenameTag old) {
   }
 
   // Note: unmap at retirement of an instruction needs to be applied to all checkpoints
-  FOR_SPECULATE_DEPTH_i {
+  if (RMAP_DELTA_CHECKPOINT) {
+    // checkpoints that have not saved lreg share mArray[lreg]
+    for(ULONGLONG live=mLive.bits; live; live&=(live-1)) {
+      ULONG i=__builtin_ctzll(live);
+      if ((lreg!=R0) && ((mDirty[i]>>lreg)&1)) {
+	if (tagEqual(mStack[i][lreg],old)) {
+	  mStack[i][lreg].mapped=false;
+	}
+      }
+    }
+  } else FOR_SPECULATE_DEPTH_i {
     // okay to overwrite all valid or invalid (don't care)
     if (lreg!=R0) {
       if (tagEqual(mStack[i][lreg],old)) {
@@ -134,26 +198,40 @@ void RMap::a7Unmap(LogicalRegName lreg, RenameTag old) {
 
   return;
 }
-#endif
 
-void RMap::rReset() { 
+template<class UArch>
+void RMap<UArch>::rReset() { 
   simTick();
 
   for(ULONG i=0; i<ARCH_NUM_LOGICAL_REG; i++)  {
-#if (UARCH_ROB_RENAME)
     mArray[i].mapped=false;
-#endif
     mArray[i].idx=i;
   }
 
+  mClock=0;
+  mLive=ZeroSpeculateMask;
+
   return; 
 }                      
-void RMap::simTick() { 
+template<class UArch>
+void RMap<UArch>::rSnapshot(Snapshot *snap) { 
+  SNAP_ARRAY(snap, mStack, UARCH_SPECULATE_DEPTH);
+  SNAP(snap, mArray);
+  SNAP_ARRAY(snap, mDirty, UARCH_SPECULATE_DEPTH);
+  SNAP_ARRAY(snap, mBorn, UARCH_SPECULATE_DEPTH);
+  SNAP(snap, mClock);
+  SNAP(snap, mLive);
+}
+
+template<class UArch>
+void RMap<UArch>::simTick() { 
 
+#if (DEBUG_LEVEL>=DEBUG_SILENT)
   dNumRead=0;
   dNumWrite=0;
   dNumUnmap=0;
   dNumCheckpoint=0;
+#endif
 
   return; 
 }                      
@@ -163,20 +241,34 @@ void RMap::simTick() {
 // Constructors
 //
 ////////////////////////////////////////////////////////
-RMap::RMap() {
+template<class UArch>
+RMap<UArch>::RMap() {
+  mStack=new RenameTag[UARCH_SPECULATE_DEPTH][ARCH_NUM_LOGICAL_REG];
+  mDirty=new ULONGLONG[UARCH_SPECULATE_DEPTH];
+  mBorn=new ULONGLONG[UARCH_SPECULATE_DEPTH];
+  ASSERT(ARCH_NUM_LOGICAL_REG<=64);  // bits in mDirty
+
   cout << "MAX_RMAP_READ=" << MAX_RMAP_READ << "\n";
   cout << "MAX_RMAP_WRITE=" << MAX_RMAP_WRITE << "\n";
   cout << "MAX_RMAP_CHECKPOINT=" << MAX_RMAP_CHECKPOINT << "\n";
-#if (UARCH_ROB_RENAME)
-  cout << "MAX_RMAP_UNMAP=" << MAX_RMAP_UNMAP << "\n";
-#endif
+  if (UARCH_ROB_RENAME) {
+    cout << "MAX_RMAP_UNMAP=" << MAX_RMAP_UNMAP << "\n";
+  }
 
   rReset();
 }
 
+template<class UArch>
+RMap<UArch>::~RMap() {
+  delete[] mStack;
+  delete[] mDirty;
+  delete[] mBorn;
+}
+
 
 // lookup logical to physical mapping upto UARCH_DECODE WIDTH
-RMapBundle RMapSS::q2GetMapSS(ULONG howmany,  Instruction inst[UARCH_DECODE_WIDTH],  RenameTag free[UARCH_DECODE_WIDTH]) {
+template<class UArch>
+RMapBundle RMapSS<UArch>::q2GetMapSS(ULONG howmany,  const Instruction inst[UARCH_MAX_DECODE_WIDTH],  RenameTag free[UARCH_MAX_DECODE_WIDTH]) {
   USAGEWARN((!simTock), "query after TOCK");
   ASSERT(howmany<=UARCH_DECODE_WIDTH);
 
@@ -205,7 +297,7 @@ RMapBundle RMapSS::q2GetMapSS(ULONG howmany,  Instruction inst[UARCH_DECODE_WIDT
   //for(ULONG i=0; i<howmany; i++) {
   FOR_DECODE_WIDTH_i {
     //okay to overrun howmany; overrun ts1/ts2/rd force to 0 anyway
-    renamed.op[i].ts1=q2GetMap(inst[i].rs1);
+    renamed.op[i].ts1=this->q2GetMap(inst[i].rs1);
     for(LONG j=i-1; j>=0; j--) {
       if ((inst[i].rs1!=R0) && (inst[i].rs1==inst[j].rd)) {
 	renamed.op[i].ts1=renamed.op[j].td;
@@ -213,7 +305,7 @@ RMapBundle RMapSS::q2GetMapSS(ULONG howmany,  Instruction inst[UARCH_DECODE_WIDT
       }
     }
 
-    renamed.op[i].ts2=q2GetMap(inst[i].rs2);
+    renamed.op[i].ts2=this->q2GetMap(inst[i].rs2);
     for(LONG j=i-1; j>=0; j--) {
       if ((inst[i].rs2!=R0) && (inst[i].rs2==inst[j].rd)) {
 	renamed.op[i].ts2=renamed.op[j].td;
@@ -221,58 +313,59 @@ RMapBundle RMapSS::q2GetMapSS(ULONG howmany,  Instruction inst[UARCH_DECODE_WIDT
       }
     }
 
-#if (!UARCH_ROB_RENAME)
-    if (inst[i].rd!=R0) {
-      // If an instruction has rd!=R0,
-      // rd was mapped to a new physical register.
-      // At retirement, the new physical register holds commited logical value.
-      // The previous rd mapping (looked up here) is returned to the freelist.
-      renamed.tdOld[i]=q2GetMap(inst[i].rd);
-      for(LONG j=i-1; j>=0; j--) {
-	// look for an oldest younger mapping of the same rd this cycle
-	if ((inst[i].rd!=R0) && (inst[i].rd==inst[j].rd)) {
-	  renamed.tdOld[i]=renamed.op[j].td;
-	  break;
+    if (!UARCH_ROB_RENAME) {
+      if (inst[i].rd!=R0) {
+	// If an instruction has rd!=R0,
+	// rd was mapped to a new physical register.
+	// At retirement, the new physical register holds commited logical value.
+	// The previous rd mapping (looked up here) is returned to the freelist.
+	renamed.tdOld[i]=this->q2GetMap(inst[i].rd);
+	for(LONG j=i-1; j>=0; j--) {
+	  // look for an oldest younger mapping of the same rd this cycle
+	  if ((inst[i].rd!=R0) && (inst[i].rd==inst[j].rd)) {
+	    renamed.tdOld[i]=renamed.op[j].td;
+	    break;
+	  }
 	}
+      } else {
+	// If an instruction has rd==R0
+	// R0 is is not mapped a physical register, but
+	// it is allocated a physical register for easy of accounting.
+	// This register is returned to the "freelist" at retirement; 
+	renamed.tdOld[i]=free[i];
       }
-    } else {
-      // If an instruction has rd==R0
-      // R0 is is not mapped a physical register, but
-      // it is allocated a physical register for easy of accounting.
-      // This register is returned to the "freelist" at retirement; 
-      renamed.tdOld[i]=free[i];
     }
-#endif
   }
 
   return renamed;
 }
 
 // set new logical to physical mapping
-void RMapSS::a2SetMapSS(ULONG howmany,  Instruction inst[UARCH_DECODE_WIDTH],  RenameTag free[UARCH_DECODE_WIDTH]) {
+template<class UArch>
+void RMapSS<UArch>::a2SetMapSS(ULONG howmany,  const Instruction inst[UARCH_MAX_DECODE_WIDTH],  RenameTag free[UARCH_MAX_DECODE_WIDTH]) {
   USAGEWARN(simTock, "action before TOCK");
 
   ASSERT(howmany<=UARCH_DECODE_WIDTH);
 
   for(ULONG i=0; i<howmany; i++) {
-    a2SetMap(inst[i].rd, free[i]);
+    this->a2SetMap(inst[i].rd, free[i]);
   }
   return;
 }
 
-#if (!UARCH_ROB_RENAME)
 // set new logical to physical mapping
-void RMapSS::a0UnmapSS(ULONG howmany,  LogicalRegName rd[UARCH_DECODE_WIDTH], RenameTag tdOld[UARCH_DECODE_WIDTH]) { 
+template<class UArch>
+void RMapSS<UArch>::a0UnmapSS(ULONG howmany,  LogicalRegName rd[UARCH_MAX_DECODE_WIDTH], RenameTag tdOld[UARCH_MAX_DECODE_WIDTH]) { 
   USAGEWARN(simTock, "action before TOCK");
+  ASSERT(!UARCH_ROB_RENAME);
 
   ASSERT(howmany<=UARCH_DECODE_WIDTH);
 
   for(ULONG i=0; i<howmany; i++) {
-    a2SetMap(rd[i], tdOld[i]);
+    this->a2SetMap(rd[i], tdOld[i]);
   }
   return;
 }
-#endif
 
 ////////////////////////////////////////////////////////
 //
@@ -280,7 +373,12 @@ void RMapSS::a0UnmapSS(ULONG howmany,  LogicalRegName rd[UARCH_DECODE_WIDTH], Re
 //
 ////////////////////////////////////////////////////////
 
-RMapSS::RMapSS() {
-  rReset();
+template<class UArch>
+RMapSS<UArch>::RMapSS() {
+  this->rReset();
 }
 
+#define INSTANTIATE_RMAP(U) template class RMap<U>;
+UARCH_FOR_EACH(INSTANTIATE_RMAP)
+#define INSTANTIATE_RMAPSS(U) template class RMapSS<U>;
+UARCH_FOR_EACH(INSTANTIATE_RMAPSS)
@@ -26,20 +26,26 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "sim.h"
 #include "arch.h"
 #include "uarch.h"
+#include "snapshot.h"
 
 #include "regfile.h"
 
-#if (UARCH_ROB_RENAME)
-#define MAX_RMAP_READ (UARCH_DECODE_WIDTH*(2))
-#else
-#define MAX_RMAP_READ (UARCH_DECODE_WIDTH*(2+1))  // new to read tdOld
-#endif
+#define MAX_RMAP_READ (UARCH_DECODE_WIDTH*(UARCH_ROB_RENAME?2:(2+1)))  // R10K: new to read tdOld
 #define MAX_RMAP_WRITE (UARCH_DECODE_WIDTH)
 #define MAX_RMAP_CHECKPOINT (1)
-#if (UARCH_ROB_RENAME)
-#define MAX_RMAP_UNMAP (UARCH_RETIRE_WIDTH)
-#endif
-
+#define MAX_RMAP_UNMAP (UARCH_RETIRE_WIDTH)  // UARCH_ROB_RENAME only
+
+//
+// With RMAP_DELTA_CHECKPOINT, a2CheckPoint saves nothing up front.
+// Instead, the first time a logical register is redefined after a
+// live checkpoint, a2SetMap saves its old mapping into that
+// checkpoint and marks it in the checkpoint's dirty bitmap;
+// a6Rewind restores only the dirty registers.  Without it, every
+// checkpoint is a full copy of the map.
+//
+#define RMAP_DELTA_CHECKPOINT (1)
+
+template<class UArch>
 class RMap {
  public:
   //
@@ -53,50 +59,58 @@ class RMap {
 
   void a6Rewind(ULONG which);
 
-#if (UARCH_ROB_RENAME)
-  void a7Unmap(LogicalRegName lreg, RenameTag old);
-#endif
+  void a6Free(ULONG which);
+
+  void a7Unmap(LogicalRegName lreg, RenameTag old); // UARCH_ROB_RENAME only
 
   void rReset();
+  void rSnapshot(Snapshot *snap);  // save or restore all state
 
   void simTick();
 
   // Constructor
   RMap();
+  ~RMap();
 
  private:
-  RenameTag mStack[UARCH_SPECULATE_DEPTH][ARCH_NUM_LOGICAL_REG];
+  RenameTag (*mStack)[ARCH_NUM_LOGICAL_REG];  // UARCH_SPECULATE_DEPTH checkpoints
   RenameTag mArray[ARCH_NUM_LOGICAL_REG];
+
+  // if RMAP_DELTA_CHECKPOINT
+  ULONGLONG *mDirty;   // by checkpoint, mStack entries saved since taken
+  ULONGLONG *mBorn;    // by checkpoint, mClock when taken 
+  ULONGLONG mClock;
+  SpeculateMask mLive; // checkpoints taken and not yet freed or rewound
+
+#if (DEBUG_LEVEL>=DEBUG_SILENT)
   ULONG dNumRead;
   ULONG dNumWrite;
   ULONG dNumUnmap;
   ULONG dNumCheckpoint;
+#endif
 };
 
 
 typedef struct {
   ULONG howmany;
-  Operation op[UARCH_DECODE_WIDTH];
-#if (!UARCH_ROB_RENAME)
-  RenameTag tdOld[UARCH_DECODE_WIDTH];
-#endif
+  Operation op[UARCH_MAX_DECODE_WIDTH];
+  RenameTag tdOld[UARCH_MAX_DECODE_WIDTH];  // !UARCH_ROB_RENAME only
 } RMapBundle;
 
-class RMapSS : public RMap {
+template<class UArch>
+class RMapSS : public RMap<UArch> {
  public:
   RMapBundle q2GetMapSS(ULONG howmany,  
-			Instruction inst[UARCH_DECODE_WIDTH],  
-			RenameTag free[UARCH_DECODE_WIDTH]); // lookup logical to physical mapping
+			const Instruction inst[UARCH_MAX_DECODE_WIDTH],  
+			RenameTag free[UARCH_MAX_DECODE_WIDTH]); // lookup logical to physical mapping
   
-#if (!UARCH_ROB_RENAME)
   void a0UnmapSS(ULONG howmany,  
-		 LogicalRegName rd[UARCH_DECODE_WIDTH], 
-		 RenameTag tdOld[UARCH_DECODE_WIDTH]); 
-#endif
+		 LogicalRegName rd[UARCH_MAX_DECODE_WIDTH], 
+		 RenameTag tdOld[UARCH_MAX_DECODE_WIDTH]); // !UARCH_ROB_RENAME only
 
   void a2SetMapSS(ULONG howmany,  
-		  Instruction inst[UARCH_DECODE_WIDTH], 
-		  RenameTag free[UARCH_DECODE_WIDTH]); // set new logical to physical mapping
+		  const Instruction inst[UARCH_MAX_DECODE_WIDTH], 
+		  RenameTag free[UARCH_MAX_DECODE_WIDTH]); // set new logical to physical mapping
   
   // Constructor
   RMapSS();
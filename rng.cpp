@@ -0,0 +1,105 @@
+#define RNG_CPP
+/*********************************************************************
+Copyright 2019 James C. Hoe
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+
+#include <cstring>
+
+#include "sim.h"
+#include "rng.h"
+
+static inline ULONG rngRotate(ULONG x, int k) {
+  return (x<<k)|(x>>(64-k));
+}
+
+ULONG Rng::getNext() {
+  if (mBufferHead==RNG_LANES) {
+    aFill(mBuffer, RNG_LANES);
+    mBufferHead=0;
+  }
+  return mBuffer[mBufferHead++];
+}
+
+void Rng::aFill(ULONG *O_Values, ULONG n) {
+  ULONG s0[RNG_LANES], s1[RNG_LANES], s2[RNG_LANES], s3[RNG_LANES];
+
+  ASSERT((n%RNG_LANES)==0);
+
+  memcpy(s0, mState[0], sizeof(s0));
+  memcpy(s1, mState[1], sizeof(s1));
+  memcpy(s2, mState[2], sizeof(s2));
+  memcpy(s3, mState[3], sizeof(s3));
+
+  for(ULONG i=0; i<n; i+=RNG_LANES) {
+    for(int l=0; l<RNG_LANES; l++) {
+      ULONG t=s1[l]<<17;
+
+      O_Values[i+l]=rngRotate(s1[l]*5, 7)*9;
+
+      s2[l]^=s0[l];
+      s3[l]^=s1[l];
+      s1[l]^=s2[l];
+      s0[l]^=s3[l];
+      s2[l]^=t;
+      s3[l]=rngRotate(s3[l], 45);
+    }
+  }
+
+  memcpy(mState[0], s0, sizeof(s0));
+  memcpy(mState[1], s1, sizeof(s1));
+  memcpy(mState[2], s2, sizeof(s2));
+  memcpy(mState[3], s3, sizeof(s3));
+}
+
+void Rng::rSeed(ULONG seed) {
+  // splitmix64
+  for(int l=0; l<RNG_LANES; l++) {
+    for(int w=0; w<4; w++) {
+      ULONG z=(seed+=0x9e3779b97f4a7c15UL);
+
+      z=(z^(z>>30))*0xbf58476d1ce4e5b9UL;
+      z=(z^(z>>27))*0x94d049bb133111ebUL;
+      mState[w][l]=z^(z>>31);
+    }
+  }
+  mBufferHead=RNG_LANES;
+}
+
+void Rng::rSnapshot(Snapshot *snap) {
+  SNAP(snap, mState);
+  SNAP(snap, mBuffer);
+  SNAP(snap, mBufferHead);
+
+  if ((!snap->qSaving())&&(mBufferHead>RNG_LANES)) {
+    snap->aFail("corrupt random state");
+  }
+}
+
+////////////////////////////////////////////////////////
+//
+// Constructors
+//
+////////////////////////////////////////////////////////
+Rng::Rng() {
+  rSeed(0);
+}
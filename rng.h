@@ -0,0 +1,62 @@
+#ifndef RNG_H
+#define RNG_H
+/*********************************************************************
+Copyright 2019 James C. Hoe
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+#include "sim.h"
+#include "snapshot.h"
+
+/*
+ * Rng is a private, explicitly seeded pseudo-random stream, so that
+ * every object drawing from one is reproducible no matter what else
+ * runs in the process.  It interleaves RNG_LANES independent
+ * xoshiro256** generators, seeded one after another from splitmix64;
+ * aFill() steps all lanes together, which the compiler can
+ * vectorize, and draws values in lane order.
+ */
+#define RNG_LANES (4)
+
+class Rng {
+ public:
+  ULONG getNext();
+  void aFill(ULONG *O_Values, ULONG n);  // n a multiple of RNG_LANES
+
+  void rSeed(ULONG seed);
+  void rSnapshot(Snapshot *snap);  // save or restore all state
+
+  // Constructor
+  Rng();
+
+ private:
+  ULONG mState[4][RNG_LANES];  // word-major, so a step is lane-parallel
+
+  ULONG mBuffer[RNG_LANES];    // for getNext()
+  ULONG mBufferHead;
+};
+
+// a value in [0, range) from 64 random bits
+static inline ULONG rngRange(ULONG value, ULONG range) {
+  return (ULONG)((((unsigned __int128)value)*range)>>64);
+}
+
+#endif
@@ -24,5 +24,5 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "sim.h"
 
-volatile Tick simTimer=0;  // global time tick
-volatile bool simTock=0;  // global clock phase
+thread_local volatile Tick simTimer=0;  // global time tick
+thread_local volatile bool simTock=0;  // global clock phase
@@ -36,10 +36,12 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define DEBUG_SILENT (2)  /* with assert, no print */
 #define DEBUG_TRACE (1)   /* no asserts, print trace */
 #define DEBUG_NONE (0)    /* no asserts, no print */
+#ifndef DEBUG_LEVEL       /* may come from the command line; see Makefile */
 //#define DEBUG_LEVEL DEBUG_VERBOSE
 #define DEBUG_LEVEL DEBUG_FULL
 //#define DEBUG_LEVEL DEBUG_SILENT
 //#define DEBUG_LEVEL DEBUG_NONE
+#endif
 
 //#define DEBUG_PRINT_DOWNSAMPLE (1<<12)
 #define DEBUG_PRINT_DOWNSAMPLE (1)
@@ -72,6 +74,8 @@ typedef signed int INT;
 typedef unsigned short USHORT;
 typedef signed short SHORT;
 
+typedef unsigned char UCHAR;
+
 static inline void simCheckTypes() {
   USAGEWARN((sizeof(ULONG)==8), "LONG is not 8 bytes.\n");
   USAGEWARN((sizeof(UINT)==4), "INT is not 4 bytes.\n");
@@ -88,8 +92,9 @@ static inline void simCheckTypes() {
 typedef LONGLONG Serial;
 typedef LONGLONG Tick;
 
-extern volatile Tick simTimer;  // global time tick
-extern volatile bool simTock;  // global clock phase
+// per-thread; belong to the Core being simulated on the thread (see core.h)
+extern thread_local volatile Tick simTimer;  // global time tick
+extern thread_local volatile bool simTock;  // global clock phase
 
 static const Tick TICK_CYC=50;
 static const double TIME_SCALE=1e-10;  
@@ -127,12 +132,25 @@ static inline bool isTwoPower(ULONG val) {
 #define MAX(a,b) (((a)>=(b))?(a):(b)) 
 
 static inline ULONG popCount(ULONG val) {
-  ULONG count=0;
-  for(ULONG i=0;i<(8*sizeof(ULONG));i++) {
-    count+=(val&1)?1:0;
-    val=val>>1;
-  }
-  return count;
+  return __builtin_popcountl(val);
+}
+
+//
+// Bitvectors of n bits kept in BITVEC_WORDS(n) ULONGLONG words
+//
+#define BITVEC_WORD_BITS (64)
+#define BITVEC_WORDS(n) (((n)+BITVEC_WORD_BITS-1)/BITVEC_WORD_BITS)
+
+static inline bool bitvecIsSet(const ULONGLONG *vec, ULONG idx) {
+  return (vec[idx/BITVEC_WORD_BITS]>>(idx%BITVEC_WORD_BITS))&1;
+}
+
+static inline void bitvecSet(ULONGLONG *vec, ULONG idx) {
+  vec[idx/BITVEC_WORD_BITS]|=(((ULONGLONG)1)<<(idx%BITVEC_WORD_BITS));
+}
+
+static inline void bitvecClear(ULONGLONG *vec, ULONG idx) {
+  vec[idx/BITVEC_WORD_BITS]&=~(((ULONGLONG)1)<<(idx%BITVEC_WORD_BITS));
 }
  
 #endif
@@ -0,0 +1,82 @@
+#define SNAPSHOT_CPP
+/*********************************************************************
+Copyright 2019 James C. Hoe
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+#include "sim.h"
+#include "snapshot.h"
+
+bool Snapshot::qSaving() {
+  return mSave;
+}
+
+bool Snapshot::qGood() {
+  return mGood;
+}
+
+void Snapshot::snapIO(void *data, ULONG bytes) {
+  if (!mGood) {
+    return;
+  }
+
+  if (mSave) {
+    if (fwrite(data, 1, bytes, mFile)!=bytes) {
+      aFail("write error");
+    }
+  } else {
+    if (fread(data, 1, bytes, mFile)!=bytes) {
+      aFail("truncated");
+    }
+  }
+}
+
+void Snapshot::aFail(const char *why) {
+  if (mGood) {
+    cerr << "snapshot: " << mFilename << ": " << why << "\n";
+  }
+  mGood=false;
+}
+
+void Snapshot::aClose() {
+  if (mFile) {
+    if (fclose(mFile)&&mSave) {
+      aFail("write error");
+    }
+    mFile=NULL;
+  }
+}
+
+////////////////////////////////////////////////////////
+//
+// Constructors
+//
+////////////////////////////////////////////////////////
+Snapshot::Snapshot(const char *filename, bool save) :
+  mFile(fopen(filename, save?"wb":"rb")), mFilename(filename), mSave(save), mGood(true) {
+  if (!mFile) {
+    aFail("cannot open");
+  }
+}
+
+Snapshot::~Snapshot() {
+  aClose();
+}
@@ -0,0 +1,63 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+/*********************************************************************
+Copyright 2019 James C. Hoe
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+#include <cstdio>
+
+#include "sim.h"
+
+//
+// A Snapshot is a binary file holding simulator state.  Every object
+// with state has an rSnapshot() that hands each of its members, in a
+// fixed order, to snapIO(); the same code thus saves into a Snapshot
+// opened for saving and restores from one opened for restoring.
+// Only the contents of arrays are stored, never pointers.  The first
+// failure is reported on cerr and turns the rest into no-ops, so
+// callers only check qGood() after aClose().
+//
+class Snapshot {
+ public:
+  bool qSaving();
+  bool qGood();
+
+  void snapIO(void *data, ULONG bytes);
+  void aFail(const char *why);
+  void aClose();  // before the final qGood()
+
+  // Constructor
+  Snapshot(const char *filename, bool save);
+  ~Snapshot();
+
+ private:
+  FILE *mFile;
+  const char *mFilename;
+  bool mSave;
+  bool mGood;
+};
+
+// a member, and the n-element array behind a pointer member
+#define SNAP(snap, x) ((snap)->snapIO(&(x), sizeof(x)))
+#define SNAP_ARRAY(snap, p, n) ((snap)->snapIO((p), (n)*sizeof(*(p))))
+
+#endif
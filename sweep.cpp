@@ -0,0 +1,348 @@
+#define SWEEP_CPP
+#define MAIN_CPP  // this is a main program; instantiate tables in arch.h
+/*********************************************************************
+Copyright 2019 James C. Hoe
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "sim.h"
+#include "arch.h"
+#include "uarch.h"
+
+#include "config.h"
+#include "core.h"
+
+/*
+ * ooo-sweep runs a list of independent simulation jobs on all host
+ * cores and writes one result record per job.
+ *
+ *    ooo-sweep [-j workers] [-o results] [-c config-file] [--option VALUE ...] [NAME=VALUE ...] joblist
+ *
+ * Each non-blank line of the job list (# starts a comment) is
+ *
+ *    name [-c config-file] [--option VALUE ...] [NAME=VALUE ...]
+ *
+ * A job's configuration starts from the defaults, then the settings
+ * given on the ooo-sweep command line, then its own settings, in
+ * order (see config.h).  Records are written in job-list order, each
+ * as soon as its job and all jobs before it are done; the ipc of a
+ * sampled job is the estimate from its windows.  A job that cannot
+ * read or write one of its files gets the record "name failed", and
+ * ooo-sweep then exits with 1 once all jobs are done.
+ *
+ * Jobs are dealt round-robin onto per-worker deques.  A worker takes
+ * its own jobs from the back and, once out, steals from the front of
+ * the other workers' deques.  Workers are pinned to the host CPUs
+ * they are allowed to run on.  Simulator printouts are suppressed,
+ * and jobs do without a trace producer thread unless --producer says
+ * otherwise.
+ */
+
+typedef struct {
+  std::string name;
+  SimConfig config;
+  CoreStats stats;
+} SweepJob;
+
+typedef struct {
+  std::mutex lock;
+  std::deque<ULONG> jobs;  // indices into the job list
+} SweepQueue;
+
+typedef struct {
+  std::mutex lock;
+  ostream *out;
+  std::vector<bool> done;  // by job
+  ULONG next;              // first job whose record is not written
+} SweepOutput;
+
+static void usage(const char *prog) {
+  cerr << "usage: " << prog << " [-j workers] [-o results] [-c config-file] [--option VALUE ...] [NAME=VALUE ...] joblist\n";
+  cerr << "  each joblist line: name [-c config-file] [--option VALUE ...] [NAME=VALUE ...]\n";
+}
+
+static bool sweepSetting(SimConfig *config, std::vector<std::string> &args) {
+  for(ULONG i=0; i<args.size(); i++) {
+    if (args[i]=="-c") {
+      if ((++i)==args.size()) {
+	cerr << "sweep: -c expects a config file\n";
+	return false;
+      }
+      if (!configLoad(config, args[i].c_str())) {
+	return false;
+      }
+    } else if (configIsOption(args[i].c_str())) {
+      if ((++i)==args.size()) {
+	cerr << "sweep: " << args[i-1] << " expects a value\n";
+	return false;
+      }
+      if (!configOption(config, args[i-1].c_str(), args[i].c_str())) {
+	return false;
+      }
+    } else if (!configAssign(config, args[i].c_str())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool sweepLoad(std::vector<SweepJob> *jobs, const SimConfig *base, const char *filename) {
+  std::ifstream file(filename);
+
+  if (!file) {
+    cerr << "sweep: cannot open " << filename << "\n";
+    return false;
+  }
+
+  std::string line;
+  ULONG lineNum=0;
+
+  while(std::getline(file, line)) {
+    lineNum++;
+
+    size_t hash=line.find('#');
+    if (hash!=std::string::npos) {
+      line.erase(hash);
+    }
+
+    std::istringstream tokens(line);
+    std::vector<std::string> args;
+    std::string token;
+    while(tokens >> token) {
+      args.push_back(token);
+    }
+    if (args.empty()) {
+      continue;
+    }
+
+    SweepJob job;
+    job.name=args[0];
+    job.config=*base;
+    args.erase(args.begin());
+    memset(&job.stats, 0, sizeof(job.stats));
+
+    if ((!sweepSetting(&job.config, args))||(!configCheck(&job.config))) {
+      cerr << "sweep: ... in job " << job.name << " at " << filename << ":" << lineNum << "\n";
+      return false;
+    }
+    jobs->push_back(job);
+  }
+
+  return true;
+}
+
+static bool sweepTake(SweepQueue *queue, ULONG numWorker, ULONG self, ULONG *job) {
+  {
+    // own jobs, newest first
+    std::lock_guard<std::mutex> guard(queue[self].lock);
+    if (!queue[self].jobs.empty()) {
+      *job=queue[self].jobs.back();
+      queue[self].jobs.pop_back();
+      return true;
+    }
+  }
+  for(ULONG i=1; i<numWorker; i++) {
+    // steal the oldest job of the next worker that has one
+    ULONG victim=(self+i)%numWorker;
+    std::lock_guard<std::mutex> guard(queue[victim].lock);
+    if (!queue[victim].jobs.empty()) {
+      *job=queue[victim].jobs.front();
+      queue[victim].jobs.pop_front();
+      return true;
+    }
+  }
+  return false;  // no job is ever added once workers start
+}
+
+static void sweepPin(ULONG self) {
+#ifdef __linux__
+  cpu_set_t allowed;
+  ULONG numCPU=0;
+
+  if (sched_getaffinity(0, sizeof(allowed), &allowed)) {
+    return;
+  }
+  numCPU=CPU_COUNT(&allowed);
+  if (!numCPU) {
+    return;
+  }
+
+  for(ULONG cpu=0, n=self%numCPU; cpu<CPU_SETSIZE; cpu++) {
+    if (CPU_ISSET(cpu, &allowed) && ((n--)==0)) {
+      cpu_set_t pin;
+      CPU_ZERO(&pin);
+      CPU_SET(cpu, &pin);
+      pthread_setaffinity_np(pthread_self(), sizeof(pin), &pin);
+      return;
+    }
+  }
+#endif
+}
+
+static void sweepPrint(ostream &out, const SweepJob *job) {
+  const CoreStats *stats=&job->stats;
+  double ipc=stats->cycles?((double)stats->insts/stats->cycles):0.0;
+  double low, high;
+
+  if (stats->failed) {
+    out << job->name << " failed\n";
+    return;
+  }
+  if (stats->windows) {
+    // sampled: the estimate over the measured windows
+    coreEstimateIPC(stats, &ipc, &low, &high);
+  }
+  out << job->name 
+      << " " << stats->cycles 
+      << " " << stats->insts 
+      << " " << ipc
+      << " " << stats->stallFetch
+      << " " << stats->stallActiveList
+      << " " << stats->stallInstQ
+      << " " << stats->stallBranch
+      << " " << stats->stallException
+      << " " << stats->rewinds
+      << " " << stats->restarts
+      << "\n";
+}
+
+// write out the records that job completes the list-order prefix of
+static void sweepDone(SweepOutput *output, const std::vector<SweepJob> &jobs, ULONG job) {
+  std::lock_guard<std::mutex> guard(output->lock);
+
+  output->done[job]=true;
+  while((output->next<jobs.size())&&output->done[output->next]) {
+    sweepPrint(*output->out, &jobs[output->next]);
+    output->next++;
+  }
+  output->out->flush();
+}
+
+static void sweepWorker(std::vector<SweepJob> *jobs, SweepQueue *queue, SweepOutput *output, 
+			ULONG numWorker, ULONG self) {
+  ULONG job;
+
+  sweepPin(self);
+
+  while(sweepTake(queue, numWorker, self, &job)) {
+    (*jobs)[job].stats=coreRun(&(*jobs)[job].config);
+    sweepDone(output, *jobs, job);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  SimConfig base;
+  std::vector<std::string> baseArgs;
+  const char *jobList=NULL;
+  const char *results=NULL;
+  ULONG numWorker=std::thread::hardware_concurrency();
+
+  for(int i=1; i<argc; i++) {
+    if ((!strcmp(argv[i], "-j"))&&((i+1)<argc)) {
+      numWorker=strtoul(argv[++i], NULL, 0);
+    } else if ((!strcmp(argv[i], "-o"))&&((i+1)<argc)) {
+      results=argv[++i];
+    } else if (((!strcmp(argv[i], "-c"))||configIsOption(argv[i]))&&((i+1)<argc)) {
+      baseArgs.push_back(argv[i]);
+      baseArgs.push_back(argv[++i]);
+    } else if ((!strcmp(argv[i], "-h"))||(!strcmp(argv[i], "--help"))) {
+      usage(argv[0]);
+      return 0;
+    } else if (strchr(argv[i], '=')) {
+      baseArgs.push_back(argv[i]);
+    } else if ((!jobList)&&(argv[i][0]!='-')) {
+      jobList=argv[i];
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (!jobList) {
+    usage(argv[0]);
+    return 1;
+  }
+  numWorker=numWorker?numWorker:1;
+
+  std::vector<SweepJob> jobs;
+
+  configDefault(&base);
+  base.producer=0;  // the workers already take up the host
+  if ((!sweepSetting(&base, baseArgs))||(!sweepLoad(&jobs, &base, jobList))) {
+    return 1;
+  }
+  numWorker=MIN(numWorker, MAX(jobs.size(), 1UL));
+
+  std::ofstream resultFile;
+  if (results) {
+    resultFile.open(results);
+    if (!resultFile) {
+      cerr << "sweep: cannot open " << results << "\n";
+      return 1;
+    }
+  }
+  // keep a stream on stdout for records; silence the simulator's
+  // printouts, which would interleave across workers
+  ostream out(results?resultFile.rdbuf():cout.rdbuf());
+  cout.setstate(std::ios::badbit);
+
+  SweepOutput output;
+  output.out=&out;
+  output.done.assign(jobs.size(), false);
+  output.next=0;
+  out << "# name cycles insts ipc stallFetch stallActiveList stallInstQ stallBranch stallException rewinds restarts\n";
+  out.flush();
+
+  SweepQueue *queue=new SweepQueue[numWorker];
+  for(ULONG i=0; i<jobs.size(); i++) {
+    queue[i%numWorker].jobs.push_front(i);  // so each worker starts from its lowest job
+  }
+
+  std::vector<std::thread> workers;
+  for(ULONG i=0; i<numWorker; i++) {
+    workers.push_back(std::thread(sweepWorker, &jobs, queue, &output, numWorker, i));
+  }
+  for(ULONG i=0; i<numWorker; i++) {
+    workers[i].join();
+  }
+  delete[] queue;
+
+  for(ULONG i=0; i<jobs.size(); i++) {
+    if (jobs[i].stats.failed) {
+      return 1;
+    }
+  }
+  return 0;
+}
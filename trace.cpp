@@ -22,6 +22,8 @@ OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
 WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 *********************************************************************/
 
+#include <cstring>
+
 #include "sim.h"
 #include "arch.h"
 #include "uarch.h"
@@ -31,6 +33,31 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 static Instruction dummyHalt={.opcode=HALT};
 
+Instruction Trace::getNext() {
+  if (mFailed) {
+    return dummyHalt;
+  }
+  if (mFile.qOpen()) {
+    return getNextFile();
+  }
+  return TRACE_RANDOM?getNextRandom():getNextTraced();
+}
+
+Instruction Trace::getNextFile() {
+  Instruction inst;
+
+  if (!mFile.getNext(&inst)) {
+    return dummyHalt;
+  }
+  mOffset++;
+
+  return inst;
+}
+
+bool Trace::qFailed() {
+  return mFailed||mFile.qFailed();
+}
+
 Instruction Trace::getNextTraced() {
   if (mOffset==(sizeof(test)/sizeof(Instruction))) {
     return dummyHalt;
@@ -48,9 +75,12 @@ Instruction Trace::getNextRandom() {
   if (mOffset==TRACE_LENGTH) {
     return dummyHalt;
   }
+  if (TRACE_SEED) {
+    return getNextBatched();
+  }
 
   {
-    ULONG dice=rand()%TRACE_TOTAL;
+    ULONG dice=random()%TRACE_TOTAL;
     
     if (dice<RANDOMIZE(TRACE_ADD_SHARE)) {
       inst.opcode=ADD;
@@ -60,7 +90,7 @@ Instruction Trace::getNextRandom() {
   }
 
 
-#define REGDICE (rand()%TRACE_RNAME_RANGE)
+#define REGDICE (random()%TRACE_RNAME_RANGE)
 #define REGDRIFT ((mOffset*TRACE_DRIFT_MUL)/TRACE_DRIFT_DIV)
 
 
@@ -80,7 +110,7 @@ Instruction Trace::getNextRandom() {
 			    (1+((REGDICE+REGDRIFT)%(ARCH_NUM_LOGICAL_REG-1))));
 
   if (inst.opcode==BEQ) {
-    ULONG dice=rand()%TRACE_BR_HITMISS;
+    ULONG dice=random()%TRACE_BR_HITMISS;
     
     if (dice<RANDOMIZE(TRACE_BR_HIT)) {
       inst.miss=false;
@@ -93,7 +123,7 @@ Instruction Trace::getNextRandom() {
   }
 
   {
-    ULONG dice=rand()%TRACE_EXCEPT_TOTAL;
+    ULONG dice=random()%TRACE_EXCEPT_TOTAL;
     if (dice<TRACE_EXCEPT) {
       inst.exception=true;
     } else {
@@ -107,8 +137,105 @@ Instruction Trace::getNextRandom() {
   return inst;
 }
 
+Instruction Trace::getNextBatched() {
+  if (mBatchHead==mBatchCount) {
+    fillBatch();
+  }
+  mOffset++;
+
+  return mBatch[mBatchHead++];
+}
+
+//
+// Generate the next up to TRACE_BATCH instructions, each from its
+// own TRACE_DICE draws (used or not), as getNextRandom() would
+//
+void Trace::fillBatch() {
+  ULONG n=MIN(TRACE_LENGTH-mOffset, TRACE_BATCH);
+  ULONG total=TRACE_TOTAL;
+  ULONG range=TRACE_RNAME_RANGE;
+  ULONG hitmiss=TRACE_BR_HITMISS;
+  ULONG exceptTotal=TRACE_EXCEPT_TOTAL;
+  ULONG regs=TRACE_WITH_R0?ARCH_NUM_LOGICAL_REG:(ARCH_NUM_LOGICAL_REG-1);
+  ULONG base=TRACE_WITH_R0?0:1;
+
+  mRng.aFill(mDice, ((n*TRACE_DICE+RNG_LANES-1)/RNG_LANES)*RNG_LANES);
+
+  for(ULONG i=0; i<n; i++) {
+    const ULONG *dice=mDice+i*TRACE_DICE;
+    ULONG drift=((mOffset+i)*TRACE_DRIFT_MUL)/TRACE_DRIFT_DIV;
+    bool add=(rngRange(dice[0], total)<TRACE_ADD_SHARE);
+
+    mBatch[i].opcode=add?ADD:BEQ;
+    mBatch[i].rd=(LogicalRegName)(add?(base+((rngRange(dice[1], range)+drift)%regs)):R0);
+    mBatch[i].rs1=(LogicalRegName)(base+((rngRange(dice[2], range)+drift)%regs));
+    mBatch[i].rs2=(LogicalRegName)(base+((rngRange(dice[3], range)+drift)%regs));
+    mBatch[i].miss=(!add)&&(rngRange(dice[4], hitmiss)>=TRACE_BR_HIT);
+    mBatch[i].exception=(rngRange(dice[5], exceptTotal)<TRACE_EXCEPT);
+  }
+
+  mBatchHead=0;
+  mBatchCount=n;
+}
+
+ULONG Trace::random() {
+  int32_t value;
+
+  random_r(&mRandom, &value);
+
+  return value;
+}
+
 void Trace::rReset() {
  this->mOffset=0;
+
+ if (mFile.qOpen()&&(!mFile.aSeek(0))) {
+   cerr << "trace: " << TRACE_FILE << ": cannot rewind a stream\n";
+   mFailed=true;
+ }
+
+ memset(&mRandom, 0, sizeof(mRandom));
+ initstate_r(1, mRandomState, sizeof(mRandomState), &mRandom);
+
+ mRng.rSeed(TRACE_SEED);
+ mBatchHead=0;
+ mBatchCount=0;
+}
+
+void Trace::rSnapshot(Snapshot *snap) {
+  // the generator points into mRandomState; only offsets are stored
+  LONG front=mRandom.fptr-mRandom.state;
+  LONG rear=mRandom.rptr-mRandom.state;
+
+  SNAP(snap, mOffset);
+  SNAP(snap, mRandomState);
+  SNAP(snap, front);
+  SNAP(snap, rear);
+  mRng.rSnapshot(snap);
+  SNAP(snap, mBatch);
+  SNAP(snap, mBatchHead);
+  SNAP(snap, mBatchCount);
+
+  if ((!snap->qSaving())&&mFile.qOpen()&&(!mFile.aSeek(mOffset))) {
+    snap->aFail("cannot seek in the trace file");
+    return;
+  }
+
+  if (!snap->qSaving()) {
+    LONG size=mRandom.end_ptr-mRandom.state;
+
+    if ((front<0)||(front>=size)||(rear<0)||(rear>=size)) {
+      snap->aFail("corrupt random state");
+      return;
+    }
+    mRandom.fptr=mRandom.state+front;
+    mRandom.rptr=mRandom.state+rear;
+
+    if ((mBatchCount>TRACE_BATCH)||(mBatchHead>mBatchCount)) {
+      snap->aFail("corrupt trace batch");
+      return;
+    }
+  }
 }
 
 ////////////////////////////////////////////////////////
@@ -116,7 +243,7 @@ void Trace::rReset() {
 // Constructors
 //
 ////////////////////////////////////////////////////////
-Trace::Trace() {
+Trace::Trace() : mFailed(false) {
   cout << "TRACE_RANDOM=" << TRACE_RANDOM << "\n";
   cout << "TRACE_WITH_R0=" << TRACE_WITH_R0 << "\n";
   cout << "TRACE_RNAME_RANGE=" << TRACE_RNAME_RANGE << "\n";
@@ -131,6 +258,36 @@ Trace::Trace() {
   cout << "TRACE_BR_HITMISS=" << TRACE_BR_HITMISS << "\n";
   cout << "TRACE_EXCEPT=" << TRACE_EXCEPT << "\n";
   cout << "TRACE_EXCEPT_TOTAL=" << TRACE_EXCEPT_TOTAL << "\n";
+  if (TRACE_SEED) {
+    cout << "TRACE_SEED=" << TRACE_SEED << "\n";
+  }
   
+  if (TRACE_FILE[0]&&(!mFile.aOpen(TRACE_FILE))) {
+    mFailed=true;
+  }
+
   rReset();
 }
+
+//
+// Write out the instructions a Trace of the given configuration
+// produces, up to its HALT, as a binary trace, block-compressed if
+// blocked
+//
+bool traceWrite(const TraceConfig *config, const char *filename, bool blocked) {
+  TraceFileWriter writer;
+
+  traceConfig=*config;
+
+  Trace trace;
+
+  if (trace.qFailed()||(!writer.aOpen(filename, blocked))) {
+    return false;
+  }
+  for(Instruction inst=trace.getNext(); inst.opcode!=HALT; inst=trace.getNext()) {
+    if (!writer.aWrite(inst)) {
+      break;
+    }
+  }
+  return writer.aClose()&&(!trace.qFailed());
+}
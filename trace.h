@@ -26,63 +26,128 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "sim.h"
 #include "arch.h"
 #include "uarch.h"
-
-#define TRACE_RANDOM (1)
-#define TRACE_USE_BASELINE (0)
-
-#if (!TRACE_USE_BASELINE)
-// for hacking
-
-#define TRACE_WITH_R0     (1)
-#define TRACE_RNAME_RANGE (2)
-#define TRACE_DRIFT_DIV   (4)
-#define TRACE_DRIFT_MUL   (1)
-#define TRACE_LENGTH      (100000)
-
-#define TRACE_ADD_SHARE (3)
-#define TRACE_BR_SHARE  (1)
-#define TRACE_TOTAL     (TRACE_ADD_SHARE+TRACE_BR_SHARE)
-
-#define TRACE_BR_HIT     (2)
-#define TRACE_BR_MISS    (1)
-#define TRACE_BR_HITMISS (TRACE_BR_HIT+TRACE_BR_MISS)
-
-#define TRACE_EXCEPT       (2)
-#define TRACE_EXCEPT_TOTAL (500)
+#include "snapshot.h"
+#include "tracefile.h"
+#include "rng.h"
+
+//
+// The values below are only the defaults.  Every TRACE_* parameter
+// can be overridden at startup by a config file or on the command
+// line (see config.h) without recompiling.
+//
+#define TRACE_DEFAULT_RANDOM (1)
+#define TRACE_DEFAULT_USE_BASELINE (0)
+
+//
+// TRACE_SEED=0 draws the random trace from the same sequence as the
+// C library rand() with its default seed, as always.  Any other
+// value seeds an Rng instead (see rng.h), which is much faster:
+// instructions are generated TRACE_BATCH at a time from
+// TRACE_DICE draws each, in a loop free of dependences between
+// instructions.  The two streams differ, but follow the same
+// TRACE_* distributions.
+//
+#define TRACE_DEFAULT_SEED (0)
+#define TRACE_BATCH (1024)
+#define TRACE_DICE (6)  // opcode, rd, rs1, rs2, branch miss, exception
+
+#define TRACE_MAX_FILENAME (256)
+
+// for hacking (TRACE_USE_BASELINE=0)
+
+#define TRACE_HACKING_WITH_R0     (1)
+#define TRACE_HACKING_RNAME_RANGE (2)
+#define TRACE_HACKING_DRIFT_DIV   (4)
+#define TRACE_HACKING_DRIFT_MUL   (1)
+#define TRACE_HACKING_LENGTH      (100000)
+
+#define TRACE_HACKING_ADD_SHARE (3)
+#define TRACE_HACKING_BR_SHARE  (1)
+
+#define TRACE_HACKING_BR_HIT     (2)
+#define TRACE_HACKING_BR_MISS    (1)
+
+#define TRACE_HACKING_EXCEPT       (2)
+#define TRACE_HACKING_EXCEPT_TOTAL (500)
+
+// for regression (TRACE_USE_BASELINE=1)
+
+#define TRACE_BASELINE_WITH_R0     (1)
+#define TRACE_BASELINE_RNAME_RANGE (2)
+#define TRACE_BASELINE_DRIFT_DIV   (4)
+#define TRACE_BASELINE_DRIFT_MUL   (1)
+#define TRACE_BASELINE_LENGTH      (10000000)
+
+#define TRACE_BASELINE_ADD_SHARE (6)
+#define TRACE_BASELINE_BR_SHARE  (1)
+
+#define TRACE_BASELINE_BR_HIT     (9)
+#define TRACE_BASELINE_BR_MISS    (1)
+
+#define TRACE_BASELINE_EXCEPT       (2)
+#define TRACE_BASELINE_EXCEPT_TOTAL (500)
 
 #define RANDOMIZE(a) (a)
 //#define RANDOMIZE(a) ((ULONG)(rand()%(a)))
 
-#else
-// for regression
-
-#define TRACE_WITH_R0     (1)
-#define TRACE_RNAME_RANGE (2)
-#define TRACE_DRIFT_DIV   (4)
-#define TRACE_DRIFT_MUL   (1)
-#define TRACE_LENGTH      (10000000)
-
-#define TRACE_ADD_SHARE (6)
-#define TRACE_BR_SHARE  (1)
+//
+// Runtime trace configuration
+//
+typedef struct {
+  ULONG random;
+  ULONG useBaseline;
+  ULONG withR0;
+  ULONG rnameRange;
+  ULONG driftDiv;
+  ULONG driftMul;
+  ULONG length;
+  ULONG addShare;
+  ULONG brShare;
+  ULONG brHit;
+  ULONG brMiss;
+  ULONG except;
+  ULONG exceptTotal;
+  ULONG seed;
+  char file[TRACE_MAX_FILENAME];  // binary trace (tracefile.h) to read
+				  // instead, if not empty
+} TraceConfig;
+
+extern thread_local TraceConfig traceConfig;  // of the Core being simulated; see core.h
+
+#define TRACE_FILE (traceConfig.file)
+#define TRACE_RANDOM (traceConfig.random)
+#define TRACE_USE_BASELINE (traceConfig.useBaseline)
+
+#define TRACE_WITH_R0     (traceConfig.withR0)
+#define TRACE_RNAME_RANGE (traceConfig.rnameRange)
+#define TRACE_DRIFT_DIV   (traceConfig.driftDiv)
+#define TRACE_DRIFT_MUL   (traceConfig.driftMul)
+#define TRACE_LENGTH      (traceConfig.length)
+
+#define TRACE_ADD_SHARE (traceConfig.addShare)
+#define TRACE_BR_SHARE  (traceConfig.brShare)
 #define TRACE_TOTAL     (TRACE_ADD_SHARE+TRACE_BR_SHARE)
 
-#define TRACE_BR_HIT     (9)
-#define TRACE_BR_MISS    (1)
+#define TRACE_BR_HIT     (traceConfig.brHit)
+#define TRACE_BR_MISS    (traceConfig.brMiss)
 #define TRACE_BR_HITMISS (TRACE_BR_HIT+TRACE_BR_MISS)
 
-#define TRACE_EXCEPT       (2)
-#define TRACE_EXCEPT_TOTAL (500)
+#define TRACE_EXCEPT       (traceConfig.except)
+#define TRACE_EXCEPT_TOTAL (traceConfig.exceptTotal)
 
-#define RANDOMIZE(a) (a)
-
-#endif
+#define TRACE_SEED (traceConfig.seed)
 
 class Trace {
  public:
+  Instruction getNext();  // from TRACE_FILE, else per TRACE_RANDOM
   Instruction getNextTraced();
   Instruction getNextRandom();
+  Instruction getNextBatched();  // getNextRandom() if TRACE_SEED
+  Instruction getNextFile();
+  bool qFailed();  // TRACE_FILE could not be read; the trace ends there
   
   void rReset();
+  void rSnapshot(Snapshot *snap);  // save or restore all state
 
   void simTick();
 
@@ -91,6 +156,27 @@ class Trace {
 
  private:
   ULONG mOffset;
+
+  TraceFile mFile;  // if TRACE_FILE
+  bool mFailed;     // TRACE_FILE could not be opened or rewound
+
+  // private random stream, so Traces in one process are independent;
+  // same sequence as the C library rand() with the default seed
+  struct random_data mRandom;
+  char mRandomState[128];
+
+  ULONG random();
+
+  // if TRACE_SEED
+  Rng mRng;
+  Instruction mBatch[TRACE_BATCH];
+  ULONG mBatchHead;
+  ULONG mBatchCount;
+  ULONG mDice[TRACE_BATCH*TRACE_DICE];  // scratch
+
+  void fillBatch();
 };
 
+bool traceWrite(const TraceConfig *config, const char *filename, bool blocked);
+
 #endif
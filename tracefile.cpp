@@ -0,0 +1,674 @@
+#define TRACEFILE_CPP
+/*********************************************************************
+Copyright 2019 James C. Hoe
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "sim.h"
+#include "arch.h"
+#include "tracefile.h"
+
+bool TraceFile::qOpen() {
+  return (mFd>=0);
+}
+
+bool TraceFile::qFailed() {
+  return mFailed;
+}
+
+bool TraceFile::decode(const UCHAR *record, Instruction *O_Inst) {
+  const TraceRecord *rec=(const TraceRecord*)record;
+
+  if (((rec->opcode!=ADD)&&(rec->opcode!=BEQ))||
+      (rec->rd>=ARCH_NUM_LOGICAL_REG)||
+      (rec->rs1>=ARCH_NUM_LOGICAL_REG)||
+      (rec->rs2>=ARCH_NUM_LOGICAL_REG)) {
+    cerr << "trace: " << mFilename << ": bad record " << mNext << "\n";
+    mFailed=true;
+    return false;
+  }
+
+  O_Inst->opcode=(OpCode)rec->opcode;
+  O_Inst->rd=(LogicalRegName)rec->rd;
+  O_Inst->rs1=(LogicalRegName)rec->rs1;
+  O_Inst->rs2=(LogicalRegName)rec->rs2;
+  O_Inst->miss=((rec->flags&TRACEFILE_MISS)!=0);
+  O_Inst->exception=((rec->flags&TRACEFILE_EXCEPTION)!=0);
+
+  return true;
+}
+
+////////////////////////////////////////////////////////
+//
+// Block codec
+//
+////////////////////////////////////////////////////////
+static UCHAR *tracefilePutVarint(UCHAR *out, UINT value) {
+  while(value>=0x80) {
+    *(out++)=(value&0x7f)|0x80;
+    value>>=7;
+  }
+  *(out++)=value;
+  return out;
+}
+
+// false if the varint runs past end or is too long
+static bool tracefileGetVarint(const UCHAR **in, const UCHAR *end, UINT *value) {
+  UINT v=0;
+
+  for(int shift=0; (shift<32)&&((*in)<end); shift+=7) {
+    UCHAR byte=*((*in)++);
+
+    v|=((UINT)(byte&0x7f))<<shift;
+    if (!(byte&0x80)) {
+      *value=v;
+      return true;
+    }
+  }
+  return false;
+}
+
+// records to zigzag varint field deltas; returns the bytes written
+static ULONG tracefilePack(const TraceRecord *recs, ULONG n, UCHAR *raw) {
+  UCHAR prev[TRACEFILE_FIELDS]={0};
+  UCHAR *out=raw;
+
+  for(ULONG i=0; i<n; i++) {
+    UCHAR field[TRACEFILE_FIELDS]={recs[i].opcode, recs[i].rd, recs[i].rs1, recs[i].rs2, recs[i].flags};
+
+    for(int k=0; k<TRACEFILE_FIELDS; k++) {
+      int delta=(int)field[k]-(int)prev[k];
+
+      out=tracefilePutVarint(out, (delta<0)?(((UINT)-delta)*2-1):(((UINT)delta)*2));
+      prev[k]=field[k];
+    }
+  }
+  return out-raw;
+}
+
+// inverse of tracefilePack; false unless bytes hold exactly n records
+static bool tracefileUnpack(const UCHAR *raw, ULONG bytes, TraceRecord *recs, ULONG n) {
+  const UCHAR *end=raw+bytes;
+  int prev[TRACEFILE_FIELDS]={0};
+
+  for(ULONG i=0; i<n; i++) {
+    for(int k=0; k<TRACEFILE_FIELDS; k++) {
+      UINT zigzag;
+
+      if (!tracefileGetVarint(&raw, end, &zigzag)) {
+	return false;
+      }
+      prev[k]+=(zigzag&1)?-(int)((zigzag+1)>>1):(int)(zigzag>>1);
+      if ((prev[k]<0)||(prev[k]>0xff)) {
+	return false;
+      }
+    }
+    recs[i].opcode=prev[0];
+    recs[i].rd=prev[1];
+    recs[i].rs1=prev[2];
+    recs[i].rs2=prev[3];
+    recs[i].flags=prev[4];
+    memset(recs[i].reserved, 0, sizeof(recs[i].reserved));
+  }
+  return (raw==end);
+}
+
+//
+// LZ: a sequence of (literal count, literals, match length less
+// TRACEFILE_LZ_MIN_MATCH, match distance) as varints, ending after
+// the literals that reach the end of the input.  Matches are found
+// greedily through a hash of the next TRACEFILE_LZ_MIN_MATCH bytes.
+//
+static ULONG tracefileCompress(const UCHAR *in, ULONG n, UCHAR *out) {
+  UINT table[1<<TRACEFILE_LZ_HASH_BITS];
+  UCHAR *start=out;
+  ULONG anchor=0;
+  ULONG i=0;
+
+  memset(table, 0xff, sizeof(table));
+
+  while((i+TRACEFILE_LZ_MIN_MATCH)<=n) {
+    UINT word;
+
+    memcpy(&word, in+i, sizeof(word));
+
+    UINT hash=(word*2654435761U)>>(32-TRACEFILE_LZ_HASH_BITS);
+    UINT cand=table[hash];
+
+    table[hash]=i;
+    if ((cand==~0U)||memcmp(in+cand, in+i, TRACEFILE_LZ_MIN_MATCH)) {
+      i++;
+      continue;
+    }
+
+    ULONG len=TRACEFILE_LZ_MIN_MATCH;
+
+    while(((i+len)<n)&&(in[cand+len]==in[i+len])) {
+      len++;
+    }
+
+    out=tracefilePutVarint(out, i-anchor);
+    memcpy(out, in+anchor, i-anchor);
+    out+=i-anchor;
+    out=tracefilePutVarint(out, len-TRACEFILE_LZ_MIN_MATCH);
+    out=tracefilePutVarint(out, i-cand);
+
+    i+=len;
+    anchor=i;
+  }
+
+  out=tracefilePutVarint(out, n-anchor);
+  memcpy(out, in+anchor, n-anchor);
+  out+=n-anchor;
+
+  return out-start;
+}
+
+// inverse of tracefileCompress; false unless in expands to exactly n bytes
+static bool tracefileExpand(const UCHAR *in, ULONG bytes, UCHAR *out, ULONG n) {
+  const UCHAR *end=in+bytes;
+  ULONG at=0;
+
+  while(true) {
+    UINT lit, len, dist;
+
+    if ((!tracefileGetVarint(&in, end, &lit))||(lit>(n-at))||(lit>(ULONG)(end-in))) {
+      return false;
+    }
+    memcpy(out+at, in, lit);
+    in+=lit;
+    at+=lit;
+    if (at==n) {
+      break;
+    }
+
+    if ((!tracefileGetVarint(&in, end, &len))||(!tracefileGetVarint(&in, end, &dist))) {
+      return false;
+    }
+    len+=TRACEFILE_LZ_MIN_MATCH;
+    if ((dist==0)||(dist>at)||(len>(n-at))) {
+      return false;
+    }
+    if (dist>=len) {
+      memcpy(out+at, out+at-dist, len);
+    } else {
+      for(ULONG j=0; j<len; j++) {
+	out[at+j]=out[at+j-dist];
+      }
+    }
+    at+=len;
+  }
+
+  return (in==end);
+}
+
+// stream until at least bytes are buffered; false at the end
+bool TraceFile::fill(ULONG bytes) {
+  if ((mBufferTail-mBufferHead)>=bytes) {
+    return true;
+  }
+
+  memmove(mBuffer, mBuffer+mBufferHead, mBufferTail-mBufferHead);
+  mBufferTail-=mBufferHead;
+  mBufferHead=0;
+
+  while((!mEnd)&&(mBufferTail<bytes)) {
+    ssize_t got=read(mFd, mBuffer+mBufferTail, TRACEFILE_STREAM_BUFFER-mBufferTail);
+
+    if (got>0) {
+      mBufferTail+=got;
+    } else {
+      mEnd=true;
+    }
+  }
+
+  return (mBufferTail>=bytes);
+}
+
+TraceBlockIndex TraceFile::qBlockIndex(ULONG block) {
+  TraceBlockIndex entry;
+
+  memcpy(&entry, mMap+mIndex+block*sizeof(entry), sizeof(entry));
+  return entry;
+}
+
+//
+// step to the next block, decoding it only if it holds the
+// target-th record; false after the last block
+//
+bool TraceFile::nextBlock(ULONG target) {
+  TraceBlockHeader header;
+  const UCHAR *packed;
+
+  if (mMap) {
+    if ((mBlockPos+sizeof(header))>mIndex) {
+      return false;
+    }
+    memcpy(&header, mMap+mBlockPos, sizeof(header));
+    packed=mMap+mBlockPos+sizeof(header);
+  } else {
+    if (!fill(sizeof(header))) {
+      return false;
+    }
+    memcpy(&header, mBuffer+mBufferHead, sizeof(header));
+    packed=NULL;
+  }
+
+  if (!header.records) {
+    return false;
+  }
+
+  bool good=(header.records<=TRACEFILE_BLOCK_RECORDS)&&(header.rawBytes<=TRACEFILE_BLOCK_RAW);
+
+  if (mMap) {
+    good=good&&(header.packedBytes<=(mIndex-mBlockPos-sizeof(header)));
+  } else {
+    good=good&&(header.packedBytes<=(TRACEFILE_STREAM_BUFFER-sizeof(header)))&&
+      fill(sizeof(header)+header.packedBytes);
+    packed=mBuffer+mBufferHead+sizeof(header);
+  }
+
+  mBlockFirst+=mBlockCount;
+  mBlockCount=header.records;
+
+  if (good&&(target<(mBlockFirst+mBlockCount))) {
+    good=tracefileExpand(packed, header.packedBytes, mRaw, header.rawBytes)&&
+      tracefileUnpack(mRaw, header.rawBytes, mBlock, header.records);
+  }
+  if (!good) {
+    cerr << "trace: " << mFilename << ": bad block at record " << mBlockFirst << "\n";
+    mFailed=true;
+    return false;
+  }
+
+  if (mMap) {
+    mBlockPos+=sizeof(header)+header.packedBytes;
+  } else {
+    mBufferHead+=sizeof(header)+header.packedBytes;
+  }
+
+  return true;
+}
+
+bool TraceFile::getNext(Instruction *O_Inst) {
+  if (mFailed) {
+    return false;
+  }
+  if (mBlocked) {
+    if ((mNext==(mBlockFirst+mBlockCount))&&(!nextBlock(mNext))) {
+      return false;
+    }
+    if (!decode((const UCHAR*)(mBlock+(mNext-mBlockFirst)), O_Inst)) {
+      return false;
+    }
+  } else if (mMap) {
+    if (mNext==mCount) {
+      return false;
+    }
+    if (!decode(mMap+sizeof(TraceFileHeader)+mNext*mRecordBytes, O_Inst)) {
+      return false;
+    }
+  } else {
+    if (!fill(mRecordBytes)) {
+      return false;
+    }
+    if (!decode(mBuffer+mBufferHead, O_Inst)) {
+      return false;
+    }
+    mBufferHead+=mRecordBytes;
+  }
+  mNext++;
+
+  return true;
+}
+
+bool TraceFile::aSeek(ULONG offset) {
+  if (mBlocked) {
+    if (mMap) {
+      if (offset>mCount) {
+	return false;
+      }
+
+      // the last block starting at or before offset
+      ULONG low=0, high=mBlocks;
+
+      while((high-low)>1) {
+	ULONG mid=(low+high)/2;
+
+	if (qBlockIndex(mid).first<=offset) {
+	  low=mid;
+	} else {
+	  high=mid;
+	}
+      }
+      mBlockPos=mBlocks?qBlockIndex(low).offset:sizeof(TraceFileHeader);
+      mBlockFirst=mBlocks?qBlockIndex(low).first:0;
+      mBlockCount=0;
+    } else if (offset<mNext) {
+      return false;
+    }
+
+    while((offset>=(mBlockFirst+mBlockCount))&&nextBlock(offset)) {
+    }
+    if (offset>(mBlockFirst+mBlockCount)) {
+      return false;
+    }
+    mNext=offset;
+    return true;
+  }
+
+  if (mMap) {
+    if (offset>mCount) {
+      return false;
+    }
+    mNext=offset;
+    return true;
+  }
+
+  // a stream only goes forward
+  if (offset<mNext) {
+    return false;
+  }
+  while(mNext<offset) {
+    if (!fill(mRecordBytes)) {
+      return false;
+    }
+    mBufferHead+=mRecordBytes;
+    mNext++;
+  }
+  return true;
+}
+
+bool TraceFile::aOpen(const char *filename) {
+  TraceFileHeader header;
+  struct stat info;
+
+  aClose();
+  mFilename=strdup(filename);
+
+  mFd=strcmp(filename, "-")?open(filename, O_RDONLY):dup(0);
+  if (mFd<0) {
+    cerr << "trace: " << filename << ": cannot open\n";
+    return false;
+  }
+
+  if ((!fstat(mFd, &info))&&S_ISREG(info.st_mode)&&(((ULONG)info.st_size)>=sizeof(header))) {
+    void *map=mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, mFd, 0);
+
+    if (map!=MAP_FAILED) {
+      mMap=(const UCHAR*)map;
+      mMapBytes=info.st_size;
+      madvise(map, mMapBytes, MADV_SEQUENTIAL);
+    }
+  }
+
+  if (mMap) {
+    memcpy(&header, mMap, sizeof(header));
+  } else {
+    mBuffer=new UCHAR[TRACEFILE_STREAM_BUFFER];
+    if (!fill(sizeof(header))) {
+      cerr << "trace: " << filename << ": not a trace file\n";
+      aClose();
+      return false;
+    }
+    memcpy(&header, mBuffer, sizeof(header));
+    mBufferHead=sizeof(header);
+  }
+
+  if (strncmp(header.magic, TRACEFILE_MAGIC, sizeof(header.magic))||
+      ((header.version!=TRACEFILE_VERSION)&&(header.version!=TRACEFILE_VERSION_BLOCKED))||
+      (header.recordBytes<sizeof(TraceRecord))||
+      (header.recordBytes>TRACEFILE_STREAM_BUFFER)) {
+    cerr << "trace: " << filename << ": not a trace file of this version\n";
+    aClose();
+    return false;
+  }
+  mRecordBytes=header.recordBytes;
+  mBlocked=(header.version==TRACEFILE_VERSION_BLOCKED);
+
+  if (mBlocked) {
+    mBlock=new TraceRecord[TRACEFILE_BLOCK_RECORDS];
+    mRaw=new UCHAR[TRACEFILE_BLOCK_RAW];
+  }
+
+  if (mBlocked&&mMap) {
+    TraceBlockTrailer trailer;
+    bool good=(mMapBytes>=(sizeof(header)+sizeof(TraceBlockHeader)+sizeof(trailer)));
+
+    if (good) {
+      memcpy(&trailer, mMap+mMapBytes-sizeof(trailer), sizeof(trailer));
+      good=(!strncmp(trailer.magic, TRACEFILE_MAGIC, sizeof(trailer.magic)))&&
+	(trailer.index>=(sizeof(header)+sizeof(TraceBlockHeader)))&&
+	(trailer.blocks<=((mMapBytes-trailer.index)/sizeof(TraceBlockIndex)))&&
+	((trailer.index+trailer.blocks*sizeof(TraceBlockIndex)+sizeof(trailer))==mMapBytes);
+    }
+    if (!good) {
+      cerr << "trace: " << filename << ": bad block index\n";
+      aClose();
+      return false;
+    }
+    mIndex=trailer.index;
+    mBlocks=trailer.blocks;
+    mCount=trailer.count;
+    mBlockPos=sizeof(header);
+  } else if (mMap) {
+    mCount=(mMapBytes-sizeof(header))/mRecordBytes;
+  }
+
+  return true;
+}
+
+void TraceFile::aClose() {
+  if (mMap) {
+    munmap((void*)mMap, mMapBytes);
+  }
+  if (mFd>=0) {
+    close(mFd);
+  }
+  delete[] mBuffer;
+  delete[] mBlock;
+  delete[] mRaw;
+  free(mFilename);
+
+  mFilename=NULL;
+  mFd=-1;
+  mRecordBytes=0;
+  mNext=0;
+  mFailed=false;
+  mMap=NULL;
+  mMapBytes=0;
+  mCount=0;
+  mBuffer=NULL;
+  mBufferHead=0;
+  mBufferTail=0;
+  mEnd=false;
+  mBlocked=false;
+  mBlocks=0;
+  mIndex=0;
+  mBlockPos=0;
+  mBlock=NULL;
+  mBlockFirst=0;
+  mBlockCount=0;
+  mRaw=NULL;
+}
+
+bool TraceFileWriter::write(const void *data, ULONG bytes) {
+  if (mGood&&bytes) {
+    mGood=(fwrite(data, bytes, 1, mFile)==1);
+    mBytes+=bytes;
+  }
+  return mGood;
+}
+
+// compress and write out the pending records as one block
+bool TraceFileWriter::flush() {
+  TraceBlockHeader header;
+
+  if (!mBlockCount) {
+    return mGood;
+  }
+
+  if (mBlocks==mIndexSize) {
+    TraceBlockIndex *index=new TraceBlockIndex[mIndexSize?(mIndexSize*2):64];
+
+    memcpy(index, mIndex, mBlocks*sizeof(TraceBlockIndex));
+    delete[] mIndex;
+    mIndex=index;
+    mIndexSize=mIndexSize?(mIndexSize*2):64;
+  }
+  mIndex[mBlocks].offset=mBytes;
+  mIndex[mBlocks].first=mCount-mBlockCount;
+  mBlocks++;
+
+  memset(&header, 0, sizeof(header));
+  header.records=mBlockCount;
+  header.rawBytes=tracefilePack(mBlock, mBlockCount, mRaw);
+  header.packedBytes=tracefileCompress(mRaw, header.rawBytes, mPacked);
+  ASSERT(header.packedBytes<=(TRACEFILE_STREAM_BUFFER-sizeof(header)));
+  mBlockCount=0;
+
+  return write(&header, sizeof(header))&&write(mPacked, header.packedBytes);
+}
+
+bool TraceFileWriter::aOpen(const char *filename, bool blocked) {
+  TraceFileHeader header;
+
+  aClose();
+  mFilename=filename;
+  mFile=strcmp(filename, "-")?fopen(filename, "wb"):stdout;
+  mGood=(mFile!=NULL);
+  if (!mGood) {
+    cerr << "trace: " << filename << ": cannot open for writing\n";
+    return false;
+  }
+
+  mBlocked=blocked;
+  if (mBlocked) {
+    mBlock=new TraceRecord[TRACEFILE_BLOCK_RECORDS];
+    mRaw=new UCHAR[TRACEFILE_BLOCK_RAW];
+    mPacked=new UCHAR[TRACEFILE_STREAM_BUFFER];
+  }
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, TRACEFILE_MAGIC, sizeof(header.magic));
+  header.version=mBlocked?TRACEFILE_VERSION_BLOCKED:TRACEFILE_VERSION;
+  header.recordBytes=sizeof(TraceRecord);
+
+  return write(&header, sizeof(header));
+}
+
+bool TraceFileWriter::aWrite(Instruction inst) {
+  TraceRecord rec;
+
+  memset(&rec, 0, sizeof(rec));
+  rec.opcode=inst.opcode;
+  rec.rd=inst.rd;
+  rec.rs1=inst.rs1;
+  rec.rs2=inst.rs2;
+  rec.flags=(inst.miss?TRACEFILE_MISS:0)|(inst.exception?TRACEFILE_EXCEPTION:0);
+
+  if (!mBlocked) {
+    return write(&rec, sizeof(rec));
+  }
+
+  mBlock[mBlockCount++]=rec;
+  mCount++;
+  if (mBlockCount==TRACEFILE_BLOCK_RECORDS) {
+    flush();
+  }
+  return mGood;
+}
+
+bool TraceFileWriter::aClose() {
+  if (mFile&&mBlocked) {
+    TraceBlockHeader end;
+    TraceBlockTrailer trailer;
+
+    flush();
+
+    memset(&end, 0, sizeof(end));
+    write(&end, sizeof(end));
+
+    memset(&trailer, 0, sizeof(trailer));
+    trailer.index=mBytes;
+    trailer.blocks=mBlocks;
+    trailer.count=mCount;
+    memcpy(trailer.magic, TRACEFILE_MAGIC, sizeof(trailer.magic));
+    write(mIndex, mBlocks*sizeof(TraceBlockIndex));
+    write(&trailer, sizeof(trailer));
+  }
+  if (mFile) {
+    if (mFile==stdout) {
+      mGood=mGood&&(!fflush(mFile));
+    } else {
+      mGood=(!fclose(mFile))&&mGood;
+    }
+    if (!mGood) {
+      cerr << "trace: " << mFilename << ": write error\n";
+    }
+    mFile=NULL;
+  }
+
+  delete[] mBlock;
+  delete[] mRaw;
+  delete[] mPacked;
+  delete[] mIndex;
+  mBlocked=false;
+  mBytes=0;
+  mCount=0;
+  mBlock=NULL;
+  mBlockCount=0;
+  mRaw=NULL;
+  mPacked=NULL;
+  mIndex=NULL;
+  mBlocks=0;
+  mIndexSize=0;
+
+  return mGood;
+}
+
+////////////////////////////////////////////////////////
+//
+// Constructors
+//
+////////////////////////////////////////////////////////
+TraceFile::TraceFile() : mFilename(NULL), mFd(-1), mMap(NULL), mBuffer(NULL), mBlock(NULL), mRaw(NULL) {
+  aClose();
+}
+
+TraceFile::~TraceFile() {
+  aClose();
+}
+
+TraceFileWriter::TraceFileWriter() : mFile(NULL), mFilename(NULL), mGood(false), 
+				     mBlock(NULL), mRaw(NULL), mPacked(NULL), mIndex(NULL) {
+  aClose();
+}
+
+TraceFileWriter::~TraceFileWriter() {
+  aClose();
+}
@@ -0,0 +1,180 @@
+#ifndef TRACEFILE_H
+#define TRACEFILE_H
+/*********************************************************************
+Copyright 2019 James C. Hoe
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+#include <cstdio>
+
+#include "sim.h"
+#include "arch.h"
+
+/*
+ * Binary trace files.  A file is a TraceFileHeader followed by one
+ * fixed-size record per instruction, in host byte order.  The header
+ * gives the record size so that fields can be added at the end of
+ * TraceRecord later; a reader takes the fields it knows and skips
+ * the rest.  Unused flag bits and reserved bytes are written as 0.
+ *
+ * A block-compressed file (TRACEFILE_VERSION_BLOCKED) instead
+ * follows the header with blocks of up to TRACEFILE_BLOCK_RECORDS
+ * records.  Each block is a TraceBlockHeader and its packed bytes,
+ * and decodes on its own: the fields of each record are stored as
+ * zigzag varint deltas from the record before (from 0 at the start
+ * of the block), and that byte string is LZ-compressed with matches
+ * only inside the block.  A TraceBlockHeader with no records ends
+ * the blocks, and is followed by a TraceBlockIndex per block and a
+ * TraceBlockTrailer, which a seek uses to go straight to the block
+ * holding an instruction.
+ *
+ * A regular file is read in place through mmap.  Anything else (a
+ * pipe, or "-" for stdin) is streamed through a buffer, and can
+ * only seek forward.
+ */
+
+#define TRACEFILE_MAGIC "oootrace"
+#define TRACEFILE_VERSION (1)
+#define TRACEFILE_VERSION_BLOCKED (2)
+#define TRACEFILE_STREAM_BUFFER (1<<16)  // bytes
+
+#define TRACEFILE_BLOCK_RECORDS (4096)
+#define TRACEFILE_FIELDS (5)  // opcode, rd, rs1, rs2, flags
+#define TRACEFILE_BLOCK_RAW (TRACEFILE_BLOCK_RECORDS*TRACEFILE_FIELDS*2)  // varint bytes, worst case
+#define TRACEFILE_LZ_MIN_MATCH (4)
+#define TRACEFILE_LZ_HASH_BITS (12)
+
+typedef struct {
+  char magic[8];     // TRACEFILE_MAGIC, not terminated
+  UINT version;
+  UINT recordBytes;  // at least sizeof(TraceRecord)
+} TraceFileHeader;
+
+#define TRACEFILE_MISS (0x1)
+#define TRACEFILE_EXCEPTION (0x2)
+
+typedef struct {
+  UCHAR opcode;      // OpCode
+  UCHAR rd, rs1, rs2;
+  UCHAR flags;       // TRACEFILE_MISS, TRACEFILE_EXCEPTION
+  UCHAR reserved[3];
+} TraceRecord;
+
+typedef struct {
+  UINT records;      // 0 after the last block
+  UINT rawBytes;     // after LZ expansion
+  UINT packedBytes;  // following this header
+  UINT reserved;
+} TraceBlockHeader;
+
+typedef struct {
+  ULONG offset;      // of its TraceBlockHeader in the file
+  ULONG first;       // index of its first record
+} TraceBlockIndex;
+
+typedef struct {
+  ULONG index;       // file offset of the TraceBlockIndex array
+  ULONG blocks;
+  ULONG count;       // records
+  char magic[8];     // TRACEFILE_MAGIC, not terminated
+} TraceBlockTrailer;
+
+class TraceFile {
+ public:
+  bool qOpen();
+  bool qFailed();  // hit a bad record or block; reads end there
+
+  bool getNext(Instruction *O_Inst);  // false past the last record
+  bool aSeek(ULONG offset);           // to the offset-th record
+
+  bool aOpen(const char *filename);   // "-" for stdin
+  void aClose();
+
+  // Constructor
+  TraceFile();
+  ~TraceFile();
+
+ private:
+  char *mFilename;     // own copy
+  int mFd;
+  ULONG mRecordBytes;
+  ULONG mNext;         // index of the next record
+  bool mFailed;
+
+  // mmap
+  const UCHAR *mMap;   // NULL if streaming
+  ULONG mMapBytes;
+  ULONG mCount;
+
+  // streaming
+  UCHAR *mBuffer;      // TRACEFILE_STREAM_BUFFER bytes
+  ULONG mBufferHead;   // next unread byte
+  ULONG mBufferTail;   // end of the bytes read in
+  bool mEnd;
+
+  // block-compressed
+  bool mBlocked;
+  ULONG mBlocks;
+  ULONG mIndex;        // file offset of the block index, if mmap
+  ULONG mBlockPos;     // file offset of the next block, if mmap
+  TraceRecord *mBlock; // decoded block, TRACEFILE_BLOCK_RECORDS
+  ULONG mBlockFirst;   // index of mBlock[0]
+  ULONG mBlockCount;   // records in mBlock
+  UCHAR *mRaw;         // TRACEFILE_BLOCK_RAW bytes
+
+  bool fill(ULONG bytes);
+  bool nextBlock(ULONG target);
+  TraceBlockIndex qBlockIndex(ULONG block);
+  bool decode(const UCHAR *record, Instruction *O_Inst);
+};
+
+class TraceFileWriter {
+ public:
+  bool aOpen(const char *filename, bool blocked);  // "-" for stdout
+  bool aWrite(Instruction inst);
+  bool aClose();
+
+  // Constructor
+  TraceFileWriter();
+  ~TraceFileWriter();
+
+ private:
+  FILE *mFile;
+  const char *mFilename;
+  bool mGood;
+
+  // block-compressed
+  bool mBlocked;
+  ULONG mBytes;               // written so far
+  ULONG mCount;               // records written or pending
+  TraceRecord *mBlock;        // pending, TRACEFILE_BLOCK_RECORDS
+  ULONG mBlockCount;
+  UCHAR *mRaw;                // TRACEFILE_BLOCK_RAW bytes
+  UCHAR *mPacked;             // TRACEFILE_STREAM_BUFFER bytes
+  TraceBlockIndex *mIndex;    // grown by doubling
+  ULONG mBlocks;
+  ULONG mIndexSize;
+
+  bool write(const void *data, ULONG bytes);
+  bool flush();
+};
+
+#endif
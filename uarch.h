@@ -29,19 +29,15 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //
 // First-Order datapath parameters 
 //
+// The values below are only the defaults.  Every UARCH_* parameter
+// can be overridden at startup by a config file or on the command
+// line (see config.h) without recompiling.
+//
 //////////////////////////////////
 
-#define UARCH_USE_BASELINE (1)   // use baseline config below
-#define UARCH_ROB_RENAME (0)     // ROB rename vs physical file
-#define UARCH_CASCADE_ISSUE4_OPRND5 (0)  // collapse issue and operand fetch to match R10K 
-
-#if (UARCH_ROB_RENAME)
-#if (DEBUG_LEVEL>=DEBUG_SILENT)
-#define UARCH_DRIS_CHECKER (1) // add Metaflow DRIS centralized
-			       // bookeeping to activelist; provided
-			       // passive checking on renaming and issue
-#endif
-#endif
+#define UARCH_DEFAULT_USE_BASELINE (1)   // use baseline config below
+#define UARCH_DEFAULT_ROB_RENAME (0)     // ROB rename vs physical file
+#define UARCH_DEFAULT_CASCADE_ISSUE4_OPRND5 (0)  // collapse issue and operand fetch to match R10K 
 
 //////////////////////////////////
 //
@@ -49,28 +45,143 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //
 //////////////////////////////////
 
-#if (!UARCH_USE_BASELINE)
+// for hacking (UARCH_USE_BASELINE=0)
+#define UARCH_HACKING_DECODE_WIDTH    (1)
+#define UARCH_HACKING_RETIRE_WIDTH    (1)
+#define UARCH_HACKING_EXECUTE_WIDTH   (1)
+#define UARCH_HACKING_OOO_DEGREE      (32)  // size of ROB
+#define UARCH_HACKING_INSTQ_SIZE      (16)  // size of each InstQ
+#define UARCH_HACKING_SPECULATE_DEPTH (4)   // depth of BR stack
+
+// for regression (UARCH_USE_BASELINE=1)
+#define UARCH_BASELINE_DECODE_WIDTH    (4)
+#define UARCH_BASELINE_RETIRE_WIDTH    (4)
+#define UARCH_BASELINE_EXECUTE_WIDTH   (3)
+#define UARCH_BASELINE_OOO_DEGREE      (32)
+#define UARCH_BASELINE_INSTQ_SIZE      (16)
+#define UARCH_BASELINE_SPECULATE_DEPTH (4)
 
-// for hacking
-#define UARCH_DECODE_WIDTH    (1)
-#define UARCH_RETIRE_WIDTH    (1)
-#define UARCH_EXECUTE_WIDTH   (1)
-#define UARCH_OOO_DEGREE      (32)  // size of ROB
-#define UARCH_INSTQ_SIZE      (16)  // size of each InstQ
-#define UARCH_SPECULATE_DEPTH (4)   // depth of BR stack
+//
+// Compile-time upper bounds on the runtime parameters.  Bundles
+// passed between pipeline stages are sized by these.
+//
+#define UARCH_MAX_DECODE_WIDTH    (8)
+#define UARCH_MAX_RETIRE_WIDTH    (8)
+#define UARCH_MAX_EXECUTE_WIDTH   (8)
+#define UARCH_MAX_SPECULATE_DEPTH (64)  // bits in a SpeculateMask
 
-#else
+//////////////////////////////////
+//
+// Runtime datapath configuration
+//
+//////////////////////////////////
 
-// for regression
-#define UARCH_DECODE_WIDTH    (4)
-#define UARCH_RETIRE_WIDTH    (4)
-#define UARCH_EXECUTE_WIDTH   (3)
-#define UARCH_OOO_DEGREE      (32)
-#define UARCH_INSTQ_SIZE      (16)
-#define UARCH_SPECULATE_DEPTH (4)
+typedef struct {
+  ULONG useBaseline;
+  ULONG robRename;
+  ULONG cascadeIssue4Oprnd5;
+  ULONG decodeWidth;
+  ULONG retireWidth;
+  ULONG executeWidth;
+  ULONG oooDegree;
+  ULONG instqSize;
+  ULONG speculateDepth;
+} UArchConfig;
+
+extern thread_local UArchConfig uarchConfig;  // of the Core being simulated; see core.h
 
+//
+// The UARCH_* macros below read the parameters through UArch.  At
+// namespace scope, UArch is UArchRuntime, which looks up the runtime
+// configuration.  The datapath and its hot objects (ActiveList,
+// InstQ, RMapSS, Checkpoint) are templates with a template parameter
+// also named UArch.  Inside them, the same macros resolve to the
+// compile-time constants of a UArchFixed<...> so that the FOR_*
+// loops are constant-folded and unrolled.
+//
+class UArchRuntime {
+ public:
+  static ULONG robRename() { return uarchConfig.robRename; }
+  static ULONG cascadeIssue4Oprnd5() { return uarchConfig.cascadeIssue4Oprnd5; }
+  static ULONG decodeWidth() { return uarchConfig.decodeWidth; }
+  static ULONG retireWidth() { return uarchConfig.retireWidth; }
+  static ULONG executeWidth() { return uarchConfig.executeWidth; }
+  static ULONG oooDegree() { return uarchConfig.oooDegree; }
+  static ULONG instqSize() { return uarchConfig.instqSize; }
+  static ULONG speculateDepth() { return uarchConfig.speculateDepth; }
+
+  static bool matches(const UArchConfig *config) { return true; }
+};
+
+template<ULONG ROB, ULONG CASCADE, 
+	 ULONG DECODE, ULONG RETIRE, ULONG EXECUTE, 
+	 ULONG OOO, ULONG INSTQ, ULONG SPECULATE>
+class UArchFixed {
+ public:
+  static constexpr ULONG robRename() { return ROB; }
+  static constexpr ULONG cascadeIssue4Oprnd5() { return CASCADE; }
+  static constexpr ULONG decodeWidth() { return DECODE; }
+  static constexpr ULONG retireWidth() { return RETIRE; }
+  static constexpr ULONG executeWidth() { return EXECUTE; }
+  static constexpr ULONG oooDegree() { return OOO; }
+  static constexpr ULONG instqSize() { return INSTQ; }
+  static constexpr ULONG speculateDepth() { return SPECULATE; }
+
+  static bool matches(const UArchConfig *config) { 
+    return ((config->robRename==ROB)&&
+	    (config->cascadeIssue4Oprnd5==CASCADE)&&
+	    (config->decodeWidth==DECODE)&&
+	    (config->retireWidth==RETIRE)&&
+	    (config->executeWidth==EXECUTE)&&
+	    (config->oooDegree==OOO)&&
+	    (config->instqSize==INSTQ)&&
+	    (config->speculateDepth==SPECULATE));
+  }
+};
+
+//
+// Hot configurations compiled with constant parameters.  Any other
+// configuration runs on the generic UArchRuntime instance.
+//
+typedef UArchFixed<0, 0,  // R10K, as in regression
+		   UARCH_BASELINE_DECODE_WIDTH, UARCH_BASELINE_RETIRE_WIDTH, UARCH_BASELINE_EXECUTE_WIDTH,
+		   UARCH_BASELINE_OOO_DEGREE, UARCH_BASELINE_INSTQ_SIZE, UARCH_BASELINE_SPECULATE_DEPTH> UArchBaseline;
+typedef UArchFixed<1, 0,  // ROB rename, as in regression
+		   UARCH_BASELINE_DECODE_WIDTH, UARCH_BASELINE_RETIRE_WIDTH, UARCH_BASELINE_EXECUTE_WIDTH,
+		   UARCH_BASELINE_OOO_DEGREE, UARCH_BASELINE_INSTQ_SIZE, UARCH_BASELINE_SPECULATE_DEPTH> UArchBaselineROB;
+typedef UArchFixed<0, 0,  // R10K, for hacking
+		   UARCH_HACKING_DECODE_WIDTH, UARCH_HACKING_RETIRE_WIDTH, UARCH_HACKING_EXECUTE_WIDTH,
+		   UARCH_HACKING_OOO_DEGREE, UARCH_HACKING_INSTQ_SIZE, UARCH_HACKING_SPECULATE_DEPTH> UArchHacking;
+
+// X(config) for every hot configuration, in the order they are matched; 
+// UArchRuntime must stay last as the catch-all
+#define UARCH_FOR_EACH(X) \
+  X(UArchBaseline)	   \
+  X(UArchBaselineROB)	   \
+  X(UArchHacking)	   \
+  X(UArchRuntime)
+
+typedef UArchRuntime UArch;  // outside of templates, parameters are looked up at runtime
+
+#define UARCH_USE_BASELINE (uarchConfig.useBaseline)
+#define UARCH_ROB_RENAME (UArch::robRename())
+#define UARCH_CASCADE_ISSUE4_OPRND5 (UArch::cascadeIssue4Oprnd5())
+
+#if (DEBUG_LEVEL>=DEBUG_SILENT)
+#define UARCH_DRIS_CHECKER (UARCH_ROB_RENAME) // add Metaflow DRIS centralized
+			                      // bookeeping to activelist; provided
+			                      // passive checking on renaming and issue
+#else
+#define UARCH_DRIS_CHECKER (0)
 #endif
 
+#define UARCH_DECODE_WIDTH    (UArch::decodeWidth())
+#define UARCH_RETIRE_WIDTH    (UArch::retireWidth())
+#define UARCH_EXECUTE_WIDTH   (UArch::executeWidth())
+#define UARCH_OOO_DEGREE      (UArch::oooDegree())
+#define UARCH_INSTQ_SIZE      (UArch::instqSize())
+#define UARCH_SPECULATE_DEPTH (UArch::speculateDepth())
+
 ////////////////////////////////////
 //
 // uarch related types and functions
@@ -85,30 +196,23 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 typedef ULONG PhysicalRegIdx;  
 
 typedef struct {
-#if (UARCH_ROB_RENAME)
-  bool mapped;
-#endif
+  bool mapped;  // only ever set if UARCH_ROB_RENAME
   ULONG idx;
 } RenameTag;  // physical register index
 
 static const RenameTag ZeroRegTag= { 
-#if (UARCH_ROB_RENAME)
   .mapped=false, 
-#endif
   .idx=0
 };
 
 static inline bool tagEqual(RenameTag a, RenameTag b) {
   bool result=(
-#if (UARCH_ROB_RENAME)
 	     (a.mapped==b.mapped)&&
-#endif
 	     (a.idx==b.idx)
 	     );
   return result;
 }
 
-#if (UARCH_DRIS_CHECKER)
 static inline bool drisTagIdxEqual(RenameTag a, RenameTag b) {
   bool result=(
 	     (a.mapped==b.mapped)&&
@@ -116,27 +220,32 @@ static inline bool drisTagIdxEqual(RenameTag a, RenameTag b) {
 	     );
   return result;
 }
-#endif
 
 static inline PhysicalRegIdx tagToPRegIdx(RenameTag a) {
-#if (UARCH_ROB_RENAME)
   if (a.mapped) {
+    ASSERT(UARCH_ROB_RENAME);
     ASSERT(a.idx<UARCH_OOO_DEGREE);
     return ARCH_NUM_LOGICAL_REG+a.idx;
   } 
-  ASSERT(a.idx<ARCH_NUM_LOGICAL_REG);
-#endif  
+  if (UARCH_ROB_RENAME) {
+    ASSERT(a.idx<ARCH_NUM_LOGICAL_REG);
+  }
   ASSERT(a.idx<UARCH_NUM_PHYSICAL_REG);
   return a.idx;
 }
 
 //
-// Branch Mask
+// Branch Mask: bit i is set for a dependence on the branch holding
+// rewind stack slot i.  Operated on as a whole word; see checkpoint.h
 // 
 typedef struct {
-  bool bit[UARCH_SPECULATE_DEPTH];
+  ULONGLONG bits;
 } SpeculateMask;
 
+static const SpeculateMask ZeroSpeculateMask={ 
+  .bits=0
+};
+
 
 //
 // Renamed instruction object in OOO datapath